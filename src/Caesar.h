@@ -3,7 +3,44 @@
 
 #include "Header.h"
 
-void encodeString(char *string, size_t incBy);
-void decodeString(char *string, size_t decBy);
+#define CAESAR_TABLE_SIZE   256 /* one entry for every possible value of an unsigned char */
+#define CAESAR_ALPHABET "ABCDEFGHIJKLMNOPQRSTUVWXYZ abcdefghijklmnopqrstuvwxyz" /* the alphabet of the module, the only one the SWAR and vector kernels know */
+#define CAESAR_ALPHABET_LEN 53
+#define CAESAR_SIMD_MIN_LENGTH  256 /* shorter strings do not make up for kernel_fpu_begin, the lookup table does them */
+#if (defined(__KERNEL__) && defined(CONFIG_X86_64)) || (!defined(__KERNEL__) && defined(__x86_64__))
+#define CAESAR_X86_SIMD /* caesar_sse2.c and caesar_avx2.c are built, see the Makefile */
+#endif
+
+typedef struct { // precomputed caesar lookup tables, indexed by the (unsigned) character to translate
+    unsigned char encode[CAESAR_TABLE_SIZE];
+    unsigned char decode[CAESAR_TABLE_SIZE];
+    int shift; // by how much encode moves a character through CAESAR_ALPHABET, in [0, CAESAR_ALPHABET_LEN). -1 for any other alphabet, only the lookup tables can do those.
+} CaesarTable;
+
+typedef enum { // the ways to run a CaesarTable over a string, every one produces the same bytes
+    CAESAR_SCALAR, // one lookup per byte, works for every alphabet
+    CAESAR_SWAR, // 8 bytes per step in a 64 bit register
+    CAESAR_SSE2, // 16 bytes per step, long strings only
+    CAESAR_AVX2, // 32 bytes per step, long strings only
+    CAESAR_IMPLEMENTATIONS
+} CaesarImplementation;
+
+extern char const *const caesarImplementationNames[CAESAR_IMPLEMENTATIONS];
+
+void initCaesarTable(CaesarTable *table, char const *alphabet, int offset);
+void encodeString(CaesarTable const *table, char *string, size_t length);
+void decodeString(CaesarTable const *table, char *string, size_t length);
+BOOL caesarImplementationAvailable(CaesarImplementation implementation);
+int selectCaesarImplementation(void);
+unsigned int caesarImplementationThroughput(CaesarImplementation implementation);
+int findCaesarImplementation(char const *name);
+int setCaesarImplementation(CaesarImplementation implementation);
+CaesarImplementation getCaesarImplementation(void);
+void encodeStringWith(CaesarImplementation implementation, CaesarTable const *table, char *string, size_t length);
+void decodeStringWith(CaesarImplementation implementation, CaesarTable const *table, char *string, size_t length);
+#ifdef CAESAR_X86_SIMD
+size_t caesarShiftSse2(char *string, size_t length, unsigned int shift); // only between kernel_fpu_begin and kernel_fpu_end
+size_t caesarShiftAvx2(char *string, size_t length, unsigned int shift); // only between kernel_fpu_begin and kernel_fpu_end
+#endif
 
 #endif // Caesar_H
@@ -0,0 +1,39 @@
+#ifndef CaesarVector_H
+#define CaesarVector_H
+
+/* The body of the SSE2 and AVX2 caesar kernels, written with GCC vector extensions. caesar_sse2.c and caesar_avx2.c include it
+ * with CAESAR_VECTOR_BYTES and CAESAR_VECTOR_FUNCTION defined and are compiled with the flags that let the compiler use the
+ * registers of that width, see the Makefile. Every other file is built without them, so only these two may ever touch vector registers.
+ */
+
+#include "Caesar.h"
+
+typedef signed char CaesarVector __attribute__((vector_size(CAESAR_VECTOR_BYTES))); // signed, bytes >= 128 are negative and fall outside of every range below
+typedef signed char CaesarUnalignedVector __attribute__((vector_size(CAESAR_VECTOR_BYTES), aligned(1), may_alias));
+
+size_t CAESAR_VECTOR_FUNCTION(char *string, size_t length, unsigned int shift) { /* moves every character of CAESAR_ALPHABET in string shift places on,
+    * CAESAR_VECTOR_BYTES bytes at a time, the same way caesarShiftSwar does. Returns how many bytes it did, the rest is left to the caller.
+    */
+    CaesarVector const shifts = (CaesarVector){} + (signed char)shift;
+    size_t done = 0U;
+    for (; done + CAESAR_VECTOR_BYTES <= length; done += CAESAR_VECTOR_BYTES) {
+        CaesarUnalignedVector *chunk = (CaesarUnalignedVector *)(string + done);
+        CaesarVector const bytes = *chunk;
+        CaesarVector const upper = (bytes >= 'A') & (bytes <= 'Z'); // comparisons give -1 (all bits) or 0 per byte
+        CaesarVector const lower = (bytes >= 'a') & (bytes <= 'z');
+        CaesarVector const space = (bytes == ' ');
+        CaesarVector const inAlphabet = upper | lower | space;
+
+        CaesarVector index = ((bytes - 'A') & upper) | ((bytes - ('a' - 27)) & lower) | (26 & space); // A-Z are 0-25, ' ' is 26 and a-z are 27-52
+        index += shifts; // < 105, fits into a signed char
+        index -= CAESAR_ALPHABET_LEN & (index >= CAESAR_ALPHABET_LEN);
+
+        CaesarVector const toUpper = (index < 26);
+        CaesarVector const toLower = (index > 26);
+        CaesarVector const shifted = ((index + 'A') & toUpper) | ((index + ('a' - 27)) & toLower) | (' ' & ~(toUpper | toLower));
+        *chunk = (shifted & inAlphabet) | (bytes & ~inAlphabet);
+    } // end for
+    return done;
+} // end CAESAR_VECTOR_FUNCTION
+
+#endif // CaesarVector_H
@@ -3,29 +3,58 @@
 
 #include "Header.h"
 #include "Caesar.h"
-#include "String.h"
+#include "Ring.h"
+#include "Stats.h"
 /* BEGIN function prototypes */
 int transDeviceOpen(struct inode *deviceFile, 
                     struct file *instance);
 int transDeviceClose(struct inode *deviceFile,
                      struct file *instance);
-ssize_t transDeviceRead(struct file *instance,
-                        char *user, size_t count,
-                        loff_t *offset);
-ssize_t transDeviceWrite(struct file *filp,
-                         char const __user *buf,
-                         size_t count,
-                         loff_t *offs);
+ssize_t transDeviceRead(struct kiocb *iocb,
+                        struct iov_iter *to);
+ssize_t transDeviceWrite(struct kiocb *iocb,
+                         struct iov_iter *from);
+__poll_t transDevicePoll(struct file *instance,
+                         poll_table *wait);
+int transDeviceMmap(struct file *instance,
+                    struct vm_area_struct *vma);
+long transDeviceIoctl(struct file *instance,
+                      unsigned int command,
+                      unsigned long argument);
 /* END function prototypes */
 
+typedef struct { // the cipher of a device, replaced as a whole when its offset changes
+    struct rcu_head rcu;
+    int offset;
+    CaesarTable caesar;
+} TransTable;
+
 typedef struct { // struct that represents a device
-    String string;
-    ssize_t maxBufSize;
+    RingBuffer ring; // the bytes that were written but not read yet
+    TransTable __rcu *table; // lookup tables for this device's offset, only used under rcu_read_lock, see transDeviceSetOffset
+    TransStats stats; // exported through /proc/translate
     ssize_t readers;
     ssize_t writers;
     int minorNumber;
-    struct semaphore sem;
-    wait_queue_head_t q;
+    BOOL encoder; // the even minor of a pair encodes, the odd one decodes
+    struct mutex readLock; // serializes readers of this device, never taken by a writer, not held while sleeping on readq
+    struct mutex writeLock; // serializes writers of this device, never taken by a reader. Only in sharedMode it is dropped while sleeping on writeq
+    wait_queue_head_t readq; // readers wait here for the ring to become non-empty
+    wait_queue_head_t writeq; // writers wait here for the ring to become non-full
+    atomic_t mappings; // how many vmas map the ring, while there are any the mapping is the producer and write returns -EBUSY
+    atomic_t transformRequested; // somebody wants the bytes of the mapped producer transformed, see transformMapped
+    struct mutex configLock; // serializes changes of the offset and the capacity
+    BOOL session; // allocated by an open in sessionMode, freed by its close
 } TransDevice;
 
+/* BEGIN function prototypes */
+int transDeviceOffset(TransDevice *device);
+int transDeviceSetOffset(TransDevice *device, int offset);
+int transDeviceResize(TransDevice *device, size_t capacity);
+int createSessionCache(void);
+void destroySessionCache(void);
+int createScratchPool(int reserved);
+void destroyScratchPool(void);
+/* END function prototypes */
+
 #endif // Device_H
@@ -1,7 +1,12 @@
 #ifndef Header_H
 #define Header_H
 
+/* #define DEBUG */ /* uncomment this to compile every PRINT_DEBUG in unconditionally, or build with make KCFLAGS=-DDEBUG. It has to come before the includes,
+* pr_debug is chosen when they are read. Without it the PRINT_DEBUGs are dynamic debug call sites that can be switched on at runtime:
+* echo 'module translate +p' > /sys/kernel/debug/dynamic_debug/control
+*/
 /* BEGIN includes */
+#ifdef __KERNEL__
 #include <linux/fs.h>
 #include <linux/version.h>
 #include <linux/module.h>
@@ -17,9 +22,30 @@
 #include <linux/fcntl.h>
 #include <linux/poll.h>
 #include <linux/string.h>
+#include <linux/log2.h> /* roundup_pow_of_two */
+#include <linux/mutex.h>
+#include <asm/barrier.h> /* smp_load_acquire, smp_store_release */
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
+#include <linux/uio.h> /* struct iov_iter, copy_to_iter, copy_from_iter */
+#include <linux/splice.h>
+#include <linux/vmalloc.h> /* vmalloc_user, the ring buffers can be mapped into user space */
+#include <linux/mm.h>
+#include <linux/device.h> /* class_create, device_create */
+#include <linux/mempool.h> /* the hot paths never depend on the allocator */
+#include <linux/rcupdate.h> /* the offset and the ring storage are replaced while readers use them */
+#include <linux/math64.h> /* div64_u64 */
+#ifdef CONFIG_X86_64
+#include <asm/cpufeature.h> /* boot_cpu_has, which caesar kernels this CPU can run */
+#include <asm/fpu/api.h> /* kernel_fpu_begin, kernel_fpu_end around the SSE2 and AVX2 caesar kernels */
+#include <asm/simd.h> /* may_use_simd */
+#endif
+#else
+#include "UserShim.h" /* caesar.c, string.c and ring.c are also built into the userspace benchmark, see make bench */
+#endif
 /* END includes */
 /* BEGIN macros */
-#define DEBUG /* comment/uncomment this to enable/disable debug mode */
 #define DRIVER_NAME "translate"
 #define MAJOR_NUMBER    0   /* 0 triggers dynamic major number selection */
 #define BUFFERSIZE  40
@@ -27,17 +53,48 @@
 #define TRUE    1
 #define FALSE   0
 #define TRANS_OFFSET    3 /* by how much to 'shift' a character on en/decoding */
-#define NUM_DEVICES 2 /* 2 devices, trans0 and trans1 */
+#define NUM_PAIRS   1 /* default number of device pairs, pair i is trans(2i) which encodes and trans(2i + 1) which decodes */
+#define MAX_PAIRS   64
 #define CHARS_IN_ALPHABET   26
 #define EXIT_OK 0
 #define EXIT_FAIL   -1
-#ifdef DEBUG
-#   define PRINT_DEBUG(formatStr, args...) printk(KERN_DEBUG DRIVER_NAME ": " formatStr, ## args)
-#else
-#   define PRINT_DEBUG(formatStr) (void)formatStr
-#endif
+#define PRINT_DEBUG(formatStr, args...) pr_debug(DRIVER_NAME ": " formatStr, ## args) /* costs nothing while disabled, see DEBUG above */
+#define PRINT_INFO(formatStr, args...) pr_info(DRIVER_NAME ": " formatStr, ## args) /* always in the kernel log, for the few things an administrator wants to see */
+#define PRINT_ERROR(formatStr, args...) pr_err(DRIVER_NAME ": " formatStr, ## args) /* always in the kernel log, why the module refused to load */
 #define COUNTOF(arr)    (sizeof(arr) / sizeof(*arr)) /* elements in array, the array must not be a pointer, beware of array to pointer decay */
+#define WRITE_CHUNK_SIZE    PAGE_SIZE /* a streamed write publishes its bytes and wakes the reader at least this often */
+#define ATOMIC_WRITE_SIZE   PAGE_SIZE /* default of atomicWriteSize, like PIPE_BUF */
+#define TRANSFORM_CHUNK_SIZE    PAGE_SIZE /* TRANS_IOC_TRANSFORM copies user memory through a scratch buffer of this size */
 #define HEAP_ALLOC8(bytes) kzalloc(bytes, GFP_KERNEL) /* allocate bytes bytes on the heap and initialize them to zero */
 /* END macros */
+/* BEGIN compatibility */
+#ifdef __KERNEL__
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4, 16, 0)
+typedef unsigned int __poll_t; /* older kernels return a plain unsigned int from file_operations.poll */
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 5, 0)
+#define TRANS_SPLICE_READ copy_splice_read /* generic_file_splice_read is gone, copy_splice_read fills the pipe through read_iter */
+#else
+#define TRANS_SPLICE_READ generic_file_splice_read /* fills the pipe through read_iter */
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 4, 0)
+#define TRANS_CLASS_CREATE(name) class_create(name)
+#define TRANS_CLASS_CONST const /* class attributes get a const struct class * since 6.4 */
+#else
+#define TRANS_CLASS_CREATE(name) class_create(THIS_MODULE, name)
+#define TRANS_CLASS_CONST
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0)
+#define TRANS_DEVNODE_CONST const /* class.devnode takes a const struct device * since 6.2 */
+#else
+#define TRANS_DEVNODE_CONST
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 5, 0)
+#define TRANS_COMPAT_IOCTL compat_ptr_ioctl /* passes 32 bit callers on with their argument converted by compat_ptr, NULL without CONFIG_COMPAT */
+#else
+#define TRANS_COMPAT_IOCTL transDeviceIoctl /* compat_ptr_ioctl does not exist yet, the argument is only wrong on s390 */
+#endif
+#endif
+/* END compatibility */
 
 #endif // Header_H
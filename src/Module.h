@@ -4,7 +4,9 @@
 #include "Header.h"
 #include "Caesar.h"
 #include "Device.h"
-#include "String.h"
+#include "Stats.h"
+#include "Ring.h"
+#include "Sysfs.h"
 /* BEGIN function prototypes */
 static int __init moduleInit(void);
 static void moduleExit(void);
@@ -0,0 +1,68 @@
+#ifndef Ring_H
+#define Ring_H
+
+#include "Header.h"
+#include "TransIoctl.h"
+
+#define PUBLIC_BEGIN
+#define PUBLIC_END
+#define PRIVATE_BEGIN
+#define PRIVATE_END
+
+#define GLUE_IMPL(a, b)  a##b
+#define GLUE(a, b) GLUE_IMPL(a, b)
+#define PRIVATE(identifier) GLUE(PRIVATE, identifier)
+
+typedef size_t ring_size_type;
+typedef char ring_value_type;
+
+#define RING_MAX_CAPACITY   (1U << 31) /* the indices are 32 bit, see TransIoctl.h */
+
+typedef struct RingBuffer_ { /* circular byte queue, the storage is a power of two so that wrapping is a mask instead of a division.
+    * One producer and one consumer may use it concurrently without a lock: only produce moves head and only consume moves tail,
+    * each publishes its index with release semantics and reads the other one with acquire semantics.
+    * The indices live in a control page in front of the storage, both can be mapped into user space (see TransIoctl.h) unless the ring came from createPrivateRingBuffer.
+    */
+    PUBLIC_BEGIN
+    void (*destructor)(struct RingBuffer_ *);
+    ring_size_type (*size)(struct RingBuffer_ const *);
+    ring_size_type (*capacity)(struct RingBuffer_ const *);
+    ring_size_type (*freeSpace)(struct RingBuffer_ const *);
+    BOOL (*isEmpty)(struct RingBuffer_ const *);
+    BOOL (*isFull)(struct RingBuffer_ const *);
+    ring_size_type (*produce)(struct RingBuffer_ *, ring_value_type const *, ring_size_type);
+    ring_size_type (*consume)(struct RingBuffer_ *, ring_value_type *, ring_size_type);
+    ring_size_type (*reserveWrite)(struct RingBuffer_ *, ring_value_type **, ring_size_type);
+    ring_size_type (*reserveWriteAfter)(struct RingBuffer_ *, ring_value_type **, ring_size_type, ring_size_type);
+    void (*commitWrite)(struct RingBuffer_ *, ring_size_type);
+    ring_size_type (*reserveRead)(struct RingBuffer_ *, ring_value_type const **, ring_size_type);
+    void (*commitRead)(struct RingBuffer_ *, ring_size_type);
+    ring_size_type (*reserveMapped)(struct RingBuffer_ *, ring_value_type **);
+    TransRingControl *(*control)(struct RingBuffer_ *);
+    ring_size_type (*mapSize)(struct RingBuffer_ const *);
+    int (*resize)(struct RingBuffer_ *, ring_size_type);
+    PUBLIC_END
+    /*----------------------------------------------------*/
+    PRIVATE_BEGIN
+    // data members:
+    TransRingControl *PRIVATE(control_); // head and tail, the start of the allocation. Replaced by resize, see size for the lockless readers.
+    ring_value_type *PRIVATE(data_); // one page after control_ if the ring is mappable
+    ring_size_type PRIVATE(capacity_); // how many bytes may be queued at most, may be less than the storage size
+    ring_size_type PRIVATE(mask_); // storage size - 1
+    BOOL PRIVATE(mappable_); // control_ came from vmalloc_user, otherwise from kvzalloc and data_ follows it directly
+    PRIVATE_END
+} RingBuffer;
+
+RingBuffer createRingBuffer(ring_size_type maxBytes); // on failure, or if maxBytes exceeds RING_MAX_CAPACITY, the returned RingBuffer has a capacity of 0
+RingBuffer createPrivateRingBuffer(ring_size_type maxBytes); // like createRingBuffer, but the storage can not be mapped and mapSize is 0
+
+#undef PRIVATE
+#undef GLUE_IMPL
+#undef GLUE
+
+#undef PUBLIC_BEGIN
+#undef PUBLIC_END
+#undef PRIVATE_BEGIN
+#undef PRIVATE_END
+
+#endif // Ring_H
@@ -0,0 +1,38 @@
+#ifndef Stats_H
+#define Stats_H
+
+#include "Header.h"
+
+#define STATS_HISTOGRAM_BUCKETS 40 /* bucket i counts durations of [2^i, 2^(i + 1)) nanoseconds, the last one everything longer (about 9 minutes) */
+#define STATS_PROC_NAME DRIVER_NAME /* /proc/translate */
+
+typedef struct { // the counters of one device on one CPU, only ever modified with this_cpu operations.
+    u64 bytesIn; // bytes accepted by write
+    u64 bytesOut; // bytes handed out by read
+    u64 writeCalls;
+    u64 readCalls;
+    u64 busyRejections; // opens that failed with -EBUSY
+    u64 writerBlocked; // how often a writer had to sleep on a full buffer
+    u64 readerBlocked; // how often a reader had to sleep on an empty buffer
+    u64 blockedHistogram[STATS_HISTOGRAM_BUCKETS]; // time spent sleeping on a full or empty buffer
+    u64 writeLatencyHistogram[STATS_HISTOGRAM_BUCKETS]; // time spent in the write syscall
+    u64 readLatencyHistogram[STATS_HISTOGRAM_BUCKETS]; // time spent in the read syscall
+} TransStatsCounters;
+
+typedef struct { // statistics of one device
+    TransStatsCounters __percpu *counters;
+    size_t highWaterMark; // the most bytes that were ever queued, only written under writeLock
+} TransStats;
+
+int initStats(TransStats *stats);
+void destroyStats(TransStats *stats);
+u64 statsNow(void);
+void statsRecordWrite(TransStats *stats, ssize_t result, u64 startNs);
+void statsRecordQueued(TransStats *stats, size_t queued);
+void statsRecordRead(TransStats *stats, ssize_t result, u64 startNs);
+void statsRecordBlocked(TransStats *stats, BOOL writer, u64 startNs);
+void statsRecordBusy(TransStats *stats);
+int createStatsProcEntry(void);
+void removeStatsProcEntry(void);
+
+#endif // Stats_H
@@ -15,6 +15,11 @@
 typedef size_t string_size_type;
 typedef char string_value_type;
 
+typedef struct { // read only access to the bytes of a String, valid until the String is modified
+    string_value_type const *data;
+    string_size_type size; // the bytes may contain '\0', use this instead of strlen
+} StringView;
+
 typedef struct String_ {
     PUBLIC_BEGIN
     void (*destructor)(struct String_ *);
@@ -38,6 +43,11 @@ typedef struct String_ {
     void (*pushFront)(struct String_ *, string_value_type);
     void (*prepend)(struct String_ *, string_value_type const *);
     string_value_type (*popFront)(struct String_ *);
+    void (*appendBytes)(struct String_ *, string_value_type const *, string_size_type);
+    string_size_type (*consume)(struct String_ *, string_size_type);
+    string_size_type (*peek)(struct String_ const *, string_value_type *, string_size_type);
+    StringView (*view)(struct String_ const *);
+    void (*setMaxCapacity)(struct String_ *, string_size_type);
     PUBLIC_END
     /*----------------------------------------------------*/
     PRIVATE_BEGIN
@@ -50,13 +60,14 @@ typedef struct String_ {
     BOOL (*PRIVATE(canBeAppended))(struct String_ const *, string_size_type);
     BOOL (*PRIVATE(fits))(struct String_ const *, string_size_type);
     void (*PRIVATE(growToFit))(struct String_ *, string_size_type);
+    string_size_type (*PRIVATE(sizeClass))(struct String_ const *, string_size_type);
    
     // data members:
     string_value_type *PRIVATE(data_);
     string_size_type PRIVATE(capacity_);
     string_size_type PRIVATE(size_);
     BOOL PRIVATE(wasFreed_);
-    string_size_type PRIVATE(growthFactor);
+    string_size_type PRIVATE(maxCapacity_); // growing stops here, appends that do not fit any more are refused
     PRIVATE_END
 } String;
 
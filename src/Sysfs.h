@@ -0,0 +1,11 @@
+#ifndef Sysfs_H
+#define Sysfs_H
+
+#include "Header.h"
+
+extern struct attribute_group const *transDeviceGroups[]; /* /sys/class/translate/trans<n>/offset and capacity, pass to device_create_with_groups
+    with the TransDevice as drvdata */
+int createClassFiles(struct class *transClass); /* /sys/class/translate/caesar_implementation and caesar_throughput */
+void removeClassFiles(struct class *transClass);
+
+#endif // Sysfs_H
@@ -0,0 +1,107 @@
+/* Tracepoints of the translate module, they cost a patched out branch until someone enables them, e.g.:
+ * echo 1 > /sys/kernel/debug/tracing/events/translate/enable
+ * perf record -e 'translate:*' ...
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM translate
+
+#if !defined(Trace_H) || defined(TRACE_HEADER_MULTI_READ) /* define_trace.h reads this header several times */
+#define Trace_H
+
+#include <linux/tracepoint.h>
+#include "Ring.h"
+
+DECLARE_EVENT_CLASS(trans_file, // a process opened or closed a device
+    TP_PROTO(int minorNumber, unsigned int mode, int result),
+    TP_ARGS(minorNumber, mode, result),
+    TP_STRUCT__entry(
+        __field(int, minorNumber)
+        __field(unsigned int, mode)
+        __field(int, result)
+    ),
+    TP_fast_assign(
+        __entry->minorNumber = minorNumber;
+        __entry->mode = mode;
+        __entry->result = result;
+    ),
+    TP_printk("device=%d mode=%s%s result=%d",
+              __entry->minorNumber,
+              (__entry->mode & FMODE_READ) ? "r" : "",
+              (__entry->mode & FMODE_WRITE) ? "w" : "",
+              __entry->result)
+);
+
+DEFINE_EVENT(trans_file, trans_open,
+    TP_PROTO(int minorNumber, unsigned int mode, int result),
+    TP_ARGS(minorNumber, mode, result)
+);
+
+DEFINE_EVENT(trans_file, trans_close,
+    TP_PROTO(int minorNumber, unsigned int mode, int result),
+    TP_ARGS(minorNumber, mode, result)
+);
+
+DECLARE_EVENT_CLASS(trans_io, // a read or write call finished
+    TP_PROTO(int minorNumber, size_t requested, ssize_t result, RingBuffer const *ring),
+    TP_ARGS(minorNumber, requested, result, ring),
+    TP_STRUCT__entry(
+        __field(int, minorNumber)
+        __field(size_t, requested)
+        __field(ssize_t, result)
+        __field(size_t, queued)
+    ),
+    TP_fast_assign(
+        __entry->minorNumber = minorNumber;
+        __entry->requested = requested;
+        __entry->result = result;
+        __entry->queued = ring->size(ring); // only evaluated while the event is enabled
+    ),
+    TP_printk("device=%d requested=%zu result=%zd queued=%zu",
+              __entry->minorNumber, __entry->requested, __entry->result, __entry->queued)
+);
+
+DEFINE_EVENT(trans_io, trans_write,
+    TP_PROTO(int minorNumber, size_t requested, ssize_t result, RingBuffer const *ring),
+    TP_ARGS(minorNumber, requested, result, ring)
+);
+
+DEFINE_EVENT(trans_io, trans_read,
+    TP_PROTO(int minorNumber, size_t requested, ssize_t result, RingBuffer const *ring),
+    TP_ARGS(minorNumber, requested, result, ring)
+);
+
+DECLARE_EVENT_CLASS(trans_wait, // a reader or writer is about to sleep or gets woken up
+    TP_PROTO(int minorNumber, bool writer, RingBuffer const *ring),
+    TP_ARGS(minorNumber, writer, ring),
+    TP_STRUCT__entry(
+        __field(int, minorNumber)
+        __field(bool, writer)
+        __field(size_t, queued)
+    ),
+    TP_fast_assign(
+        __entry->minorNumber = minorNumber;
+        __entry->writer = writer;
+        __entry->queued = ring->size(ring); // only evaluated while the event is enabled
+    ),
+    TP_printk("device=%d side=%s queued=%zu",
+              __entry->minorNumber, __entry->writer ? "writer" : "reader", __entry->queued)
+);
+
+DEFINE_EVENT(trans_wait, trans_block,
+    TP_PROTO(int minorNumber, bool writer, RingBuffer const *ring),
+    TP_ARGS(minorNumber, writer, ring)
+);
+
+DEFINE_EVENT(trans_wait, trans_wake,
+    TP_PROTO(int minorNumber, bool writer, RingBuffer const *ring),
+    TP_ARGS(minorNumber, writer, ring)
+);
+
+#endif // Trace_H
+
+/* this part has to be outside of the include guard */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH . /* the Makefile adds the module's directory to the include path of device.o */
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE Trace
+#include <trace/define_trace.h>
@@ -0,0 +1,64 @@
+#ifndef TransIoctl_H
+#define TransIoctl_H
+
+/* The interface that user space sees besides read and write: the layout of the mmap'ed ring and the ioctl numbers.
+ * Included by the module and by user space programs (see loadgen/), so it only uses the uapi headers.
+ *
+ * mmap(NULL, ioctl(fd, TRANS_IOC_MAP_SIZE), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) maps a control page followed by the data area.
+ * The mapping takes the producer role of the device: the program writes plaintext into the data area at produced, publishes it by
+ * advancing produced (store release) and the module runs the cipher over it in place before it moves head. The consumer, read() or a
+ * mapping, takes the bytes between tail and head and advances tail. All indices are free running and wrap at 2^32, a byte
+ * with index i is at dataOffset + (i & (dataSize - 1)). At most capacity bytes may be between tail and produced.
+ *
+ * The file has to be opened O_RDWR: mmap needs read access and the producer role needs write access. Outside of sharedMode (which, like
+ * sessionMode, can not be mapped) such a file also is the device's only reader, so another process that opens the device for reading gets
+ * -EBUSY. The consumer has to use the same file, in the same process (another thread) or in one that inherited or was passed the descriptor.
+ *
+ * The module only notices produced when somebody reads, polls or rings the doorbell. A producer has to ring it only when
+ * readerWaiting is set (check it after a full memory barrier following the store to produced), a mapped consumer only
+ * when writerWaiting is set after it advanced tail. Otherwise neither side needs a syscall.
+ *
+ * TRANS_IOC_TRANSFORM runs the cipher over user memory in place and never touches the ring, so it may be used by any number of threads
+ * at once. Opening the device with the access mode O_ACCMODE (3) gives a file that is good for ioctl only and does not count
+ * as the device's reader or writer.
+ */
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+typedef __u32 ring_index_type;
+
+typedef struct { // the first page of the mapping
+    ring_index_type head; // written by the module: the end of the transformed bytes
+    ring_index_type tail; // written by the consumer: the next byte to consume
+    ring_index_type produced; // written by a mapped producer: the end of the plaintext in the data area, head catches up to it
+    __u32 capacity; // how many bytes may be queued at most
+    __u32 dataSize; // size of the data area, a power of two
+    __u32 dataOffset; // where the data area starts in the mapping
+    __u32 readerWaiting; // set by the module while a reader sleeps on an empty ring
+    __u32 writerWaiting; // set by the module while a writer sleeps on a full ring
+} TransRingControl;
+
+#define TRANS_ENCODE    0
+#define TRANS_DECODE    1
+#define TRANS_TRANSFORM_MAX_SEGMENTS    1024
+
+typedef struct { // one piece of user memory for TRANS_IOC_TRANSFORM
+    __u64 data; // the address of the bytes, they are replaced by their translation
+    __u64 length;
+    __u32 direction; // TRANS_ENCODE or TRANS_DECODE
+    __s32 offset; // the caesar offset, any value, negative ones shift the other way
+} TransTransformSegment;
+
+typedef struct {
+    __u64 segments; // the address of count TransTransformSegments, done in order
+    __u32 count; // at most TRANS_TRANSFORM_MAX_SEGMENTS
+    __u32 reserved; // must be 0
+} TransTransformRequest;
+
+#define TRANS_IOC_MAGIC 't'
+#define TRANS_IOC_DOORBELL  _IO(TRANS_IOC_MAGIC, 1) /* transform what a mapped producer published and wake whoever waits, returns the bytes transformed */
+#define TRANS_IOC_MAP_SIZE  _IO(TRANS_IOC_MAGIC, 2) /* returns how many bytes to mmap */
+#define TRANS_IOC_TRANSFORM _IOW(TRANS_IOC_MAGIC, 3, TransTransformRequest) /* returns the bytes transformed, at most INT_MAX per call (the rest is left as it is), -EFAULT leaves earlier segments transformed */
+
+#endif // TransIoctl_H
@@ -0,0 +1,95 @@
+#ifndef UserShim_H
+#define UserShim_H
+
+/* Stand-ins for the few kernel facilities that caesar.c, string.c and ring.c use, so that they can be compiled
+ * into a userspace program (see bench/). Only included by Header.h when __KERNEL__ is not defined.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <errno.h> /* the ring reports errors like the kernel does, as negative errno values */
+#include <time.h>
+
+typedef uint64_t u64;
+typedef uint32_t u32;
+typedef uint8_t u8;
+
+#define GFP_KERNEL  0
+#define kmalloc(bytes, flags)   malloc(bytes)
+#define kzalloc(bytes, flags)   calloc(1U, bytes)
+#define kfree(ptr)  free((void *)(ptr))
+#define krealloc(ptr, bytes, flags) realloc(ptr, bytes)
+#define KMALLOC_MAX_SIZE    ((size_t)1U << 30) /* the kernel's limit is a few MiB, the benchmark goes up to 16 MiB */
+#define vfree(ptr)  free((void *)(ptr))
+#define kvzalloc(bytes, flags)  calloc(1U, bytes)
+#define kvfree(ptr) free((void *)(ptr))
+
+#ifdef DEBUG
+#   define pr_debug(formatStr, args...) fprintf(stderr, formatStr, ## args)
+#else
+#   define pr_debug(formatStr, args...) ((void)0)
+#endif
+
+static inline u64 ktime_get_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+#define preempt_disable()   ((void)0)
+#define preempt_enable()    ((void)0)
+#define div64_u64(dividend, divisor)    ((dividend) / (divisor))
+
+#define min(a, b)   ({ __typeof__(a) minA_ = (a); __typeof__(b) minB_ = (b); minA_ < minB_ ? minA_ : minB_; })
+#define max(a, b)   ({ __typeof__(a) maxA_ = (a); __typeof__(b) maxB_ = (b); maxA_ > maxB_ ? maxA_ : maxB_; })
+#define min_t(type, a, b)   min((type)(a), (type)(b))
+#define max_t(type, a, b)   max((type)(a), (type)(b))
+
+#define PAGE_SIZE   4096UL
+#define PAGE_ALIGN(bytes)   (((bytes) + PAGE_SIZE - 1U) & ~(PAGE_SIZE - 1U))
+
+static inline void *vmalloc_user(size_t bytes) { // zeroed and page aligned like the real one
+    void *memory = NULL;
+    if (posix_memalign(&memory, PAGE_SIZE, PAGE_ALIGN(bytes)) != 0) {
+        return NULL;
+    } // end if
+    memset(memory, 0, PAGE_ALIGN(bytes));
+    return memory;
+}
+
+#define READ_ONCE(x)    __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define WRITE_ONCE(x, value)    __atomic_store_n(&(x), (value), __ATOMIC_RELAXED)
+#define smp_load_acquire(ptr)   __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define smp_store_release(ptr, value)   __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#define smp_mb()    __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#define rcu_read_lock() ((void)0) /* the userspace programs never resize a ring while another thread looks at it */
+#define rcu_read_unlock()   ((void)0)
+#define rcu_dereference(ptr)    __atomic_load_n(&(ptr), __ATOMIC_CONSUME)
+#define rcu_assign_pointer(ptr, value)  __atomic_store_n(&(ptr), (value), __ATOMIC_RELEASE)
+#define synchronize_rcu()   ((void)0)
+
+#ifdef __x86_64__ /* the feature tests of caesar.c, the benchmark runs the vector kernels without saving any registers */
+#define boot_cpu_has(feature)   (__builtin_cpu_supports(feature) != 0)
+#define X86_FEATURE_XMM2    "sse2"
+#define X86_FEATURE_AVX2    "avx2"
+#define cpu_has_xfeatures(mask, name)   1 /* __builtin_cpu_supports("avx2") already asks whether the OS saves the ymm registers */
+#define may_use_simd()  1
+#define kernel_fpu_begin()  ((void)0)
+#define kernel_fpu_end()    ((void)0)
+#endif
+
+static inline unsigned long roundup_pow_of_two(unsigned long n) {
+    unsigned long power = 1UL;
+    while (power < n) {
+        power <<= 1;
+    } // end while
+    return power;
+}
+
+#endif // UserShim_H
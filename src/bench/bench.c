@@ -0,0 +1,343 @@
+/* Userspace microbenchmark for caesar.c, string.c and ring.c, built and run by make bench (no root, no module).
+ * Prints ns/byte for every operation and input size and compares it to a stored baseline if one is given.
+ * Every caesar implementation this CPU can run gets its own rows, with cycles/byte from the time stamp counter on x86
+ * (which ticks at the nominal clock, not the turbo clock), after its output has been checked against the lookup table.
+ *
+ * usage: translate_bench [--baseline file] [--save file]
+ */
+#include <time.h>
+#ifdef __x86_64__
+#include <x86intrin.h> /* __rdtsc */
+#endif
+#include "../Caesar.h"
+#include "../String.h"
+#include "../Ring.h"
+
+#define MIN_SIZE    (size_t)16U
+#define MAX_SIZE    ((size_t)16U * 1024U * 1024U) /* 16 MiB */
+#define SIZE_STEP   16U /* sizes grow by this factor */
+#define CHUNK_SIZE  (size_t)64U /* bytes per call for the String and ring operations that work in pieces */
+#define TIME_BUDGET_NS  500000000ULL /* per operation and size, quadratic operations stop early and report how far they got */
+#define MAX_RESULTS 64
+#define NAME_LEN    32
+
+typedef struct { // one line of output
+    char name[NAME_LEN];
+    size_t size;
+    double nsPerByte;
+    double cyclesPerByte; // 0 without a cycle counter
+    size_t bytesDone; // less than size if the time budget ran out
+} BenchResult;
+
+typedef size_t (*BenchFunction)(char *buffer, size_t size, u64 deadline); // returns how many bytes it processed
+
+static CaesarTable table;
+static volatile unsigned char sink; // keeps the compiler from discarding results
+static CaesarImplementation benchImplementation; // the one benchEncodeWith and benchDecodeWith run
+
+static u64 nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+static u64 nowCycles(void) {
+#ifdef __x86_64__
+    return __rdtsc();
+#else
+    return 0U;
+#endif
+}
+
+static void fillText(char *buffer, size_t size) { // letters, spaces and some punctuation, but never '\0' so String can handle it.
+    static char const text[] = "The quick brown fox jumps over the lazy dog, 0123456789!\n";
+    for (size_t i = 0U; i < size; ++i) {
+        buffer[i] = text[i % (sizeof(text) - 1U)];
+    } // end for
+}
+
+static size_t benchEncode(char *buffer, size_t size, u64 deadline) {
+    encodeString(&table, buffer, size);
+    sink = (unsigned char)buffer[size / 2U];
+    return size;
+}
+
+static size_t benchDecode(char *buffer, size_t size, u64 deadline) {
+    decodeString(&table, buffer, size);
+    sink = (unsigned char)buffer[size / 2U];
+    return size;
+}
+
+static size_t benchEncodeWith(char *buffer, size_t size, u64 deadline) {
+    encodeStringWith(benchImplementation, &table, buffer, size);
+    sink = (unsigned char)buffer[size / 2U];
+    return size;
+}
+
+static size_t benchDecodeWith(char *buffer, size_t size, u64 deadline) {
+    decodeStringWith(benchImplementation, &table, buffer, size);
+    sink = (unsigned char)buffer[size / 2U];
+    return size;
+}
+
+static size_t benchStringAppend(char *buffer, size_t size, u64 deadline) { // grows a String to size bytes in CHUNK_SIZE pieces
+    char chunk[CHUNK_SIZE + 1U];
+    memcpy(chunk, buffer, CHUNK_SIZE);
+    chunk[CHUNK_SIZE] = '\0';
+    String string = createString();
+    size_t done = 0U;
+    while (done < size && nowNs() < deadline) {
+        size_t len = min(CHUNK_SIZE, size - done);
+        chunk[len] = '\0';
+        string.append(&string, chunk);
+        done += len;
+    } // end while
+    sink = (unsigned char)string.size(&string);
+    string.destructor(&string);
+    return done;
+}
+
+static size_t benchStringPopFront(char *buffer, size_t size, u64 deadline) { // drains a String of size bytes one character at a time
+    char saved = buffer[size];
+    buffer[size] = '\0';
+    String string = createString();
+    string.fromBuffer(&string, buffer);
+    buffer[size] = saved;
+    size_t done = 0U;
+    while (done < size && nowNs() < deadline) {
+        sink = (unsigned char)string.popFront(&string);
+        ++done;
+    } // end while
+    string.destructor(&string);
+    return done;
+}
+
+static size_t benchStringPrepend(char *buffer, size_t size, u64 deadline) { // grows a String to size bytes by prepending CHUNK_SIZE pieces
+    char chunk[CHUNK_SIZE + 1U];
+    memcpy(chunk, buffer, CHUNK_SIZE);
+    chunk[CHUNK_SIZE] = '\0';
+    String string = createString();
+    size_t done = 0U;
+    while (done < size && nowNs() < deadline) {
+        size_t len = min(CHUNK_SIZE, size - done);
+        chunk[len] = '\0';
+        string.prepend(&string, chunk);
+        done += len;
+    } // end while
+    sink = (unsigned char)string.size(&string);
+    string.destructor(&string);
+    return done;
+}
+
+static size_t benchStringAppendBytes(char *buffer, size_t size, u64 deadline) { // like String.append, but with lengths instead of '\0'
+    String string = createString();
+    size_t done = 0U;
+    while (done < size && nowNs() < deadline) {
+        size_t len = min(CHUNK_SIZE, size - done);
+        string.appendBytes(&string, buffer + done, len);
+        done += len;
+    } // end while
+    sink = (unsigned char)string.size(&string);
+    string.destructor(&string);
+    return done;
+}
+
+static size_t benchStringConsume(char *buffer, size_t size, u64 deadline) { // drains a String of size bytes in CHUNK_SIZE pieces
+    char chunk[CHUNK_SIZE];
+    String string = createString();
+    string.appendBytes(&string, buffer, size);
+    size_t done = 0U;
+    while (done < size && nowNs() < deadline) {
+        size_t len = string.peek(&string, chunk, CHUNK_SIZE);
+        done += string.consume(&string, len);
+        sink = (unsigned char)chunk[0];
+    } // end while
+    string.destructor(&string);
+    return done;
+}
+
+static size_t benchRing(char *buffer, size_t size, u64 deadline) { // pushes size bytes through a ring of WRITE_CHUNK_SIZE bytes, like the device does
+    char chunk[CHUNK_SIZE];
+    RingBuffer ring = createRingBuffer(WRITE_CHUNK_SIZE);
+    size_t done = 0U;
+    while (done < size) {
+        done += ring.produce(&ring, buffer + done, min(CHUNK_SIZE, size - done));
+        sink = (unsigned char)ring.consume(&ring, chunk, CHUNK_SIZE);
+    } // end while
+    ring.destructor(&ring);
+    return done;
+}
+
+static BenchResult runBench(char const *name, BenchFunction function, char *buffer, size_t size) {
+    BenchResult result;
+    snprintf(result.name, NAME_LEN, "%s", name);
+    result.size = size;
+    u64 deadline = nowNs() + TIME_BUDGET_NS;
+    u64 bytes = 0U;
+    u64 elapsed = 0U;
+    u64 cycles = 0U;
+    size_t firstRun = 0U;
+    for (unsigned int run = 0U; run == 0U || nowNs() < deadline; ++run) { // repeat short operations until the budget is used up.
+        u64 start = nowNs();
+        u64 startCycles = nowCycles();
+        size_t done = function(buffer, size, deadline);
+        cycles += nowCycles() - startCycles;
+        elapsed += nowNs() - start;
+        bytes += done;
+        if (run == 0U) {
+            firstRun = done;
+        } // end if
+        if (done < size) { // the operation itself ran out of time, one run is all we get.
+            break;
+        } // end if
+    } // end for
+    result.nsPerByte = (bytes == 0U) ? 0.0 : (double)elapsed / (double)bytes;
+    result.cyclesPerByte = (bytes == 0U) ? 0.0 : (double)cycles / (double)bytes;
+    result.bytesDone = firstRun;
+    return result;
+}
+
+static int loadBaseline(char const *path, BenchResult *baseline, int capacity) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return 0;
+    } // end if
+    int count = 0;
+    while (count < capacity
+           && fscanf(file, "%31s %zu %lf", baseline[count].name, &baseline[count].size, &baseline[count].nsPerByte) == 3) {
+        ++count;
+    } // end while
+    fclose(file);
+    return count;
+}
+
+static BenchResult const *findBaseline(BenchResult const *baseline, int count, BenchResult const *result) {
+    for (int i = 0; i < count; ++i) {
+        if (baseline[i].size == result->size && strcmp(baseline[i].name, result->name) == 0) {
+            return &baseline[i];
+        } // end if
+    } // end for
+    return NULL;
+}
+
+static void reportResult(BenchResult const *result, BenchResult const *baseline, int baselineCount, FILE *save) {
+    BenchResult const *base = findBaseline(baseline, baselineCount, result);
+    printf("%-22s %10zu %12.3f", result->name, result->size, result->nsPerByte);
+    if (result->cyclesPerByte > 0.0) {
+        printf(" %10.3f", result->cyclesPerByte);
+    } else {
+        printf(" %10s", "-");
+    } // end if
+    if (base != NULL && base->nsPerByte > 0.0) {
+        printf(" %9.2fx", result->nsPerByte / base->nsPerByte); // < 1 is faster than the baseline
+    } else {
+        printf(" %10s", "-");
+    } // end if
+    if (result->bytesDone < result->size) {
+        printf("  (time budget exhausted after %zu bytes)", result->bytesDone);
+    } // end if
+    printf("\n");
+    if (save != NULL) {
+        fprintf(save, "%s %zu %.3f\n", result->name, result->size, result->nsPerByte);
+    } // end if
+}
+
+static BOOL matchesScalar(CaesarImplementation implementation, char *buffer, char *expected) { // a quick check, make fuzz is the thorough one
+    fillText(expected, MAX_SIZE);
+    encodeStringWith(CAESAR_SCALAR, &table, expected, MAX_SIZE);
+    fillText(buffer, MAX_SIZE);
+    encodeStringWith(implementation, &table, buffer, MAX_SIZE);
+    BOOL matches = memcmp(buffer, expected, MAX_SIZE) == 0;
+    fillText(buffer, MAX_SIZE);
+    return matches;
+}
+
+int main(int argc, char **argv) {
+    char const *baselinePath = NULL;
+    char const *savePath = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            savePath = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--baseline file] [--save file]\n", argv[0]);
+            return EXIT_FAILURE;
+        } // end if
+    } // end for
+
+    static struct {
+        char const *name;
+        BenchFunction function;
+    } const benches[] = {
+        { "encodeString", &benchEncode },
+        { "decodeString", &benchDecode },
+        { "String.append", &benchStringAppend },
+        { "String.popFront", &benchStringPopFront },
+        { "String.prepend", &benchStringPrepend },
+        { "String.appendBytes", &benchStringAppendBytes },
+        { "String.peek+consume", &benchStringConsume },
+        { "Ring.produce+consume", &benchRing },
+    };
+
+    static struct {
+        char const *name;
+        BenchFunction function;
+    } const caesarBenches[] = { // once for every implementation
+        { "encode", &benchEncodeWith },
+        { "decode", &benchDecodeWith },
+    };
+
+    initCaesarTable(&table, CAESAR_ALPHABET, TRANS_OFFSET);
+    selectCaesarImplementation(); // for encodeString and decodeString, like moduleInit
+    char *buffer = malloc(MAX_SIZE + 1U); // + 1 for the '\0' that String needs
+    char *expected = malloc(MAX_SIZE);
+    if (buffer == NULL || expected == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    } // end if
+    fillText(buffer, MAX_SIZE);
+
+    BenchResult baseline[MAX_RESULTS];
+    int baselineCount = (baselinePath != NULL) ? loadBaseline(baselinePath, baseline, MAX_RESULTS) : 0;
+    FILE *save = (savePath != NULL) ? fopen(savePath, "w") : NULL;
+
+    printf("%-22s %10s %12s %10s %10s\n", "operation", "bytes", "ns/byte", "cyc/byte", "vs base");
+    for (size_t b = 0U; b < COUNTOF(benches); ++b) {
+        for (size_t size = MIN_SIZE; size <= MAX_SIZE; size *= SIZE_STEP) {
+            BenchResult result = runBench(benches[b].name, benches[b].function, buffer, size);
+            fillText(buffer, MAX_SIZE); // undo the en/decoding
+            reportResult(&result, baseline, baselineCount, save);
+        } // end for sizes
+    } // end for benches
+
+    int exitCode = EXIT_SUCCESS;
+    for (int implementation = 0; implementation < CAESAR_IMPLEMENTATIONS; ++implementation) {
+        if (!caesarImplementationAvailable((CaesarImplementation)implementation)) {
+            printf("%s: not available on this CPU\n", caesarImplementationNames[implementation]);
+            continue;
+        } // end if
+        if (!matchesScalar((CaesarImplementation)implementation, buffer, expected)) {
+            printf("%s: output differs from the lookup table, not measured\n", caesarImplementationNames[implementation]);
+            exitCode = EXIT_FAILURE;
+            continue;
+        } // end if
+        benchImplementation = (CaesarImplementation)implementation;
+        for (size_t b = 0U; b < COUNTOF(caesarBenches); ++b) {
+            char name[NAME_LEN];
+            snprintf(name, NAME_LEN, "%s.%s", caesarBenches[b].name, caesarImplementationNames[implementation]);
+            for (size_t size = MIN_SIZE; size <= MAX_SIZE; size *= SIZE_STEP) {
+                BenchResult result = runBench(name, caesarBenches[b].function, buffer, size);
+                fillText(buffer, MAX_SIZE);
+                reportResult(&result, baseline, baselineCount, save);
+            } // end for sizes
+        } // end for benches
+    } // end for implementations
+
+    if (save != NULL) {
+        fclose(save);
+    } // end if
+    free(buffer);
+    free(expected);
+    return exitCode;
+}
@@ -0,0 +1,188 @@
+/* Userspace stress benchmark of the lock-free RingBuffer against the semaphore path it replaced, built and run by make ring-stress.
+ * One producer thread and one consumer thread move fixed-size messages through one ring for a while, twice:
+ *   lockfree   each side takes only its own mutex, like readLock and writeLock of a device since the ring went lock free
+ *   semaphore  both sides take one shared semaphore around every produce and consume, like the device semaphore before
+ * Both variants yield the CPU when the ring is full or empty, so only the locking differs. Every message carries the time it was produced,
+ * the consumer records its latency. Prints ops/s (messages), MB/s and the p50/p99 latency in nanoseconds per variant.
+ *
+ * usage: translate_ring_stress [--seconds n] [--size bytes] [--capacity bytes]
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include "../Ring.h"
+
+#define DEFAULT_SECONDS 2
+#define DEFAULT_MESSAGE_SIZE    64U
+#define DEFAULT_CAPACITY    4096U
+#define MAX_MESSAGE_SIZE    4096U
+#define MAX_SAMPLES ((size_t)1U << 24) /* latencies kept per run, later messages are counted but not sampled */
+
+typedef struct { // one run of one variant
+    RingBuffer ring;
+    BOOL shared; // the semaphore variant
+    sem_t semaphore; // the shared lock of the semaphore variant
+    pthread_mutex_t writeLock; // the per-side locks of the lock-free variant
+    pthread_mutex_t readLock;
+    size_t messageSize;
+    u64 deadline;
+    volatile int stop; // the producer is done, the consumer drains what is left
+    u64 produced; // messages
+    u64 consumed;
+    u64 *samples;
+    size_t sampleCount;
+} StressRun;
+
+static u64 nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+static void lockSide(StressRun *run, pthread_mutex_t *side) {
+    if (run->shared) {
+        sem_wait(&run->semaphore);
+    } else {
+        pthread_mutex_lock(side);
+    } // end if
+}
+
+static void unlockSide(StressRun *run, pthread_mutex_t *side) {
+    if (run->shared) {
+        sem_post(&run->semaphore);
+    } else {
+        pthread_mutex_unlock(side);
+    } // end if
+}
+
+static void *producerThread(void *argument) {
+    StressRun *run = argument;
+    char message[MAX_MESSAGE_SIZE];
+    memset(message, 'x', run->messageSize);
+    while (nowNs() < run->deadline) {
+        u64 stamp = nowNs();
+        memcpy(message, &stamp, sizeof(stamp)); // the first bytes of every message are its production time
+        size_t done = 0U;
+        while (done < run->messageSize) {
+            lockSide(run, &run->writeLock);
+            done += run->ring.produce(&run->ring, message + done, run->messageSize - done);
+            unlockSide(run, &run->writeLock);
+            if (done < run->messageSize) { // full, let the consumer run
+                sched_yield();
+            } // end if
+        } // end while
+        ++run->produced;
+    } // end while
+    __atomic_store_n(&run->stop, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void *consumerThread(void *argument) {
+    StressRun *run = argument;
+    char message[MAX_MESSAGE_SIZE];
+    size_t done = 0U;
+    for (;;) {
+        lockSide(run, &run->readLock);
+        size_t got = run->ring.consume(&run->ring, message + done, run->messageSize - done);
+        unlockSide(run, &run->readLock);
+        done += got;
+        if (done == run->messageSize) {
+            u64 stamp;
+            memcpy(&stamp, message, sizeof(stamp));
+            if (run->sampleCount < MAX_SAMPLES) {
+                run->samples[run->sampleCount++] = nowNs() - stamp;
+            } // end if
+            ++run->consumed;
+            done = 0U;
+        } else if (got == 0U) { // empty
+            if (__atomic_load_n(&run->stop, __ATOMIC_ACQUIRE) && run->ring.isEmpty(&run->ring)) {
+                break;
+            } // end if
+            sched_yield();
+        } // end if
+    } // end for
+    return NULL;
+}
+
+static int compareU64(void const *lhs, void const *rhs) {
+    u64 a = *(u64 const *)lhs;
+    u64 b = *(u64 const *)rhs;
+    return (a > b) - (a < b);
+}
+
+static int runStress(char const *name, BOOL shared, size_t messageSize, size_t capacity, long seconds, u64 *samples) {
+    StressRun run;
+    memset(&run, 0, sizeof(run));
+    run.ring = createRingBuffer(capacity);
+    if (run.ring.capacity(&run.ring) == 0U) {
+        fprintf(stderr, "could not create a ring of %zu bytes\n", capacity);
+        return EXIT_FAILURE;
+    } // end if
+    run.shared = shared;
+    sem_init(&run.semaphore, 0, 1U);
+    pthread_mutex_init(&run.writeLock, NULL);
+    pthread_mutex_init(&run.readLock, NULL);
+    run.messageSize = messageSize;
+    run.samples = samples;
+    u64 const start = nowNs();
+    run.deadline = start + (u64)seconds * 1000000000ULL;
+
+    pthread_t producer;
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, &consumerThread, &run);
+    pthread_create(&producer, NULL, &producerThread, &run);
+    pthread_join(producer, NULL);
+    pthread_join(consumer, NULL);
+    double const elapsed = (double)(nowNs() - start) / 1e9;
+
+    qsort(run.samples, run.sampleCount, sizeof(*run.samples), &compareU64);
+    u64 p50 = (run.sampleCount == 0U) ? 0U : run.samples[run.sampleCount / 2U];
+    u64 p99 = (run.sampleCount == 0U) ? 0U : run.samples[(size_t)((double)(run.sampleCount - 1U) * 0.99)];
+    printf("%-10s %10zu %10zu %14.0f %10.1f %10llu %10llu\n", name, messageSize, run.ring.capacity(&run.ring), (double)run.consumed / elapsed,
+           (double)run.consumed * (double)messageSize / elapsed / 1e6, (unsigned long long)p50, (unsigned long long)p99);
+
+    run.ring.destructor(&run.ring);
+    sem_destroy(&run.semaphore);
+    pthread_mutex_destroy(&run.writeLock);
+    pthread_mutex_destroy(&run.readLock);
+    if (run.consumed != run.produced) {
+        fprintf(stderr, "%s: produced %llu messages but consumed %llu\n", name, (unsigned long long)run.produced, (unsigned long long)run.consumed);
+        return EXIT_FAILURE;
+    } // end if
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    long seconds = DEFAULT_SECONDS;
+    size_t messageSize = DEFAULT_MESSAGE_SIZE;
+    size_t capacity = DEFAULT_CAPACITY;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = strtol(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            messageSize = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--capacity") == 0 && i + 1 < argc) {
+            capacity = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [--seconds n] [--size bytes] [--capacity bytes]\n", argv[0]);
+            return EXIT_FAILURE;
+        } // end if
+    } // end for
+    if (messageSize < sizeof(u64) || messageSize > MAX_MESSAGE_SIZE || messageSize > capacity) {
+        fprintf(stderr, "--size must be between %zu and %u bytes and at most --capacity\n", sizeof(u64), MAX_MESSAGE_SIZE);
+        return EXIT_FAILURE;
+    } // end if
+    u64 *samples = malloc(MAX_SAMPLES * sizeof(*samples));
+    if (samples == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    } // end if
+
+    printf("%-10s %10s %10s %14s %10s %10s %10s\n", "variant", "msg bytes", "capacity", "ops/s", "MB/s", "p50 ns", "p99 ns");
+    int exitCode = runStress("lockfree", FALSE, messageSize, capacity, seconds, samples);
+    if (exitCode == EXIT_SUCCESS) {
+        exitCode = runStress("semaphore", TRUE, messageSize, capacity, seconds, samples);
+    } // end if
+    free(samples);
+    return exitCode;
+}
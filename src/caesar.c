@@ -1,72 +1,207 @@
 #include "Caesar.h"
 
-static void incrementCharPointer(char const **ptr, char const *begin, char const *end);
-static char caesarChar(char getNextOfThis, size_t incBy, BOOL encode);
-static void ensureCharPointerIsValid(char const **ptr, char const *begin, char const *end);
-static void decrementCharPointer(char const **ptr, char const *begin, char const *end);
-static void caesarString(char *string, size_t caesarOffset, BOOL encode);
-
-extern char *alphabet; // from module.c
-extern size_t const alphBufSiz; // from module.c
-
-static char caesarChar(char caesarThis, size_t changeBy, BOOL encode) {
-    char const *end // pointer to the end of the string
-        = alphabet + (alphBufSiz - (size_t)2U); // If the array is of size 4 adding the size (4) to the pointer to the beginning of the array will make it point to &arr[4], which is out of bounds by 1, thus we subtract 1. Then we subtract 1 again, because a string of 4 chars is of size 5 as it has to hold the '\0' char.
-
-    char const *pointer = strchr(alphabet, caesarThis);
-    if (pointer == NULL) {
-        return caesarThis;
-    }
-    for (size_t i = 0U; i < changeBy; ++i) {
-        if (encode) {
-            incrementCharPointer(&pointer, // address of the pointer to modify
-                                 alphabet, // pointer to the beginning of the string
-                                 end // pointer to the end of the string. 
-                                );
-        } else {
-            decrementCharPointer(&pointer, alphabet, end);
-        }
-    }
-    return *pointer;
+#define SWAR_HIGH   0x8080808080808080ULL /* the high bit of every byte of a u64 */
+#define SWAR_BYTES(value)   ((u64)(value) * 0x0101010101010101ULL) /* value in every byte of a u64 */
+#define BENCHMARK_NS    2000000ULL /* how long selectCaesarImplementation measures each implementation, with preemption disabled */
+
+char const *const caesarImplementationNames[CAESAR_IMPLEMENTATIONS] = { "scalar", "swar", "sse2", "avx2" };
+static CaesarImplementation selectedImplementation = CAESAR_SCALAR; // what encodeString and decodeString use, see selectCaesarImplementation
+static unsigned int measuredThroughput[CAESAR_IMPLEMENTATIONS]; // MB/s of encodeString, 0 for the ones this CPU can not run
+
+static void caesarString(unsigned char const *lookup, char *string, size_t length);
+static u64 swarAtLeast(u64 word, unsigned int bound);
+static u64 swarMask(u64 high);
+static size_t caesarShiftSwar(char *string, size_t length, unsigned int shift);
+static void caesarShift(CaesarImplementation implementation, unsigned char const *lookup, int shift, char *string, size_t length);
+static unsigned int measureThroughput(CaesarImplementation implementation, CaesarTable const *table, char *buffer);
+
+void initCaesarTable(CaesarTable *table, char const *alphabet, int offset) {
+    for (size_t i = 0U; i < CAESAR_TABLE_SIZE; ++i) { // characters that are not in the alphabet are left as they are.
+        table->encode[i] = (unsigned char)i;
+        table->decode[i] = (unsigned char)i;
+    } // end for
+    table->shift = -1;
+
+    int const alphabetLen = (int)strlen(alphabet);
+    if (alphabetLen == 0) {
+        PRINT_DEBUG("empty alphabet in %s\n", __FUNCTION__);
+        return;
+    } // end if
+    int const shift = ((offset % alphabetLen) + alphabetLen) % alphabetLen; // shifting by the length of the alphabet is a full turn, so only the remainder matters. This also maps negative offsets into [0, alphabetLen).
+
+    for (int i = 0; i < alphabetLen; ++i) {
+        unsigned char const plain = (unsigned char)alphabet[i];
+        unsigned char const cipher = (unsigned char)alphabet[(i + shift) % alphabetLen];
+        table->encode[plain] = cipher;
+        table->decode[cipher] = plain;
+    } // end for
+    if (strcmp(alphabet, CAESAR_ALPHABET) == 0) {
+        table->shift = shift;
+    } // end if
+} // end initCaesarTable
+
+static void caesarString(unsigned char const *lookup, char *string, size_t length) {
+    for (size_t i = 0U; i < length; ++i) {
+        string[i] = (char)lookup[(unsigned char)string[i]];
+    } // end for
 }
 
-static void ensureCharPointerIsValid(char const **ptr, char const *begin, char const *end) {
-    if (ptr == NULL || *ptr == NULL || *ptr < begin || *ptr > end) {
-        PRINT_DEBUG("ptr in ensureCharPointerIsValid was invalid.\n");
-    }
+static u64 swarAtLeast(u64 word, unsigned int bound) { // the high bit of every byte of word that is >= bound. Every byte of word and bound have to be < 128, then no sum carries into the next byte.
+    return (word + SWAR_BYTES(128U - bound)) & SWAR_HIGH;
 }
 
-static void incrementCharPointer(char const **ptr, char const *begin, char const *end) {
-    ensureCharPointerIsValid(ptr, begin, end);
-    if (*ptr == end) {
-        *ptr = begin;
-    } else {
-        ++*ptr;
-    }
+static u64 swarMask(u64 high) { // widens the high bits that swarAtLeast returns to whole bytes
+    return (high >> 7) * 0xFFU;
+}
+
+static size_t caesarShiftSwar(char *string, size_t length, unsigned int shift) { /* moves every character of CAESAR_ALPHABET in string shift places on, 8 bytes at a time.
+    * Returns how many bytes it did, a multiple of 8, the rest is left to the caller.
+    */
+    size_t done = 0U;
+    for (; done + sizeof(u64) <= length; done += sizeof(u64)) {
+        u64 word;
+        memcpy(&word, string + done, sizeof(word)); // string need not be aligned
+        u64 const low = word & ~SWAR_HIGH; // keeps swarAtLeast exact, bytes >= 128 are not in the alphabet anyway and ascii drops them
+        u64 const ascii = ~word & SWAR_HIGH;
+        u64 const upper = swarMask(swarAtLeast(low, 'A') & ~swarAtLeast(low, 'Z' + 1) & ascii);
+        u64 const lower = swarMask(swarAtLeast(low, 'a') & ~swarAtLeast(low, 'z' + 1) & ascii);
+        u64 const space = swarMask(swarAtLeast(low, ' ') & ~swarAtLeast(low, ' ' + 1) & ascii);
+        u64 const inAlphabet = upper | lower | space;
+
+        // the position in CAESAR_ALPHABET, A-Z are 0-25, ' ' is 26 and a-z are 27-52. Setting the high bit first keeps every subtraction inside its byte.
+        u64 index = ((((low | SWAR_HIGH) - SWAR_BYTES('A')) & upper) | (((low | SWAR_HIGH) - SWAR_BYTES('a' - 27)) & lower) | (SWAR_BYTES(26) & space)) & ~SWAR_HIGH;
+        index += SWAR_BYTES(shift); // < 105, still no carries
+        index -= SWAR_BYTES(CAESAR_ALPHABET_LEN) & swarMask(swarAtLeast(index, CAESAR_ALPHABET_LEN)); // wraps around
+
+        u64 const toUpper = ~swarMask(swarAtLeast(index, 26));
+        u64 const toLower = swarMask(swarAtLeast(index, 27));
+        u64 const shifted = ((index + SWAR_BYTES('A')) & toUpper) | ((index + SWAR_BYTES('a' - 27)) & toLower) | (SWAR_BYTES(' ') & ~(toUpper | toLower));
+        word = (shifted & inAlphabet) | (word & ~inAlphabet);
+        memcpy(string + done, &word, sizeof(word));
+    } // end for
+    return done;
+} // end caesarShiftSwar
+
+static void caesarShift(CaesarImplementation implementation, unsigned char const *lookup, int shift, char *string, size_t length) { /* The vector kernel does the long middle,
+    * the lookup table short strings and the tail. SWAR only runs when it is the selected implementation, after a vector kernel or on a short string it is slower
+    * than the table. Alphabets other than CAESAR_ALPHABET (shift < 0) always go through the lookup table.
+    */
+    size_t done = 0U;
+    if (shift >= 0) {
+#ifdef CAESAR_X86_SIMD
+        if ((implementation == CAESAR_SSE2 || implementation == CAESAR_AVX2) && length >= CAESAR_SIMD_MIN_LENGTH && may_use_simd()) {
+            kernel_fpu_begin(); // disables preemption, the callers in device.c never pass more than TRANSFORM_CHUNK_SIZE bytes at once
+            if (implementation == CAESAR_AVX2) {
+                done = caesarShiftAvx2(string, length, (unsigned int)shift);
+            } else {
+                done = caesarShiftSse2(string, length, (unsigned int)shift);
+            } // end if
+            kernel_fpu_end();
+        } // end if
+#endif
+        if (implementation == CAESAR_SWAR) {
+            done = caesarShiftSwar(string + done, length - done, (unsigned int)shift);
+        } // end if
+    } // end if
+    caesarString(lookup, string + done, length - done);
+} // end caesarShift
+
+void encodeString(CaesarTable const *table, char *string, size_t length) {
+    caesarShift(READ_ONCE(selectedImplementation), table->encode, table->shift, string, length);
 }
 
-static void decrementCharPointer(char const **ptr, char const *begin, char const *end) {
-    ensureCharPointerIsValid(ptr, begin, end);
-    if (*ptr == begin) {
-        *ptr = end;
-    } else {
-        --*ptr;
-    }
+void decodeString(CaesarTable const *table, char *string, size_t length) {
+    caesarShift(READ_ONCE(selectedImplementation), table->decode, (table->shift < 0) ? -1 : (CAESAR_ALPHABET_LEN - table->shift) % CAESAR_ALPHABET_LEN, string, length);
+}
+
+void encodeStringWith(CaesarImplementation implementation, CaesarTable const *table, char *string, size_t length) { // implementation has to be available
+    caesarShift(implementation, table->encode, table->shift, string, length);
+}
+
+void decodeStringWith(CaesarImplementation implementation, CaesarTable const *table, char *string, size_t length) { // implementation has to be available
+    caesarShift(implementation, table->decode, (table->shift < 0) ? -1 : (CAESAR_ALPHABET_LEN - table->shift) % CAESAR_ALPHABET_LEN, string, length);
+}
+
+BOOL caesarImplementationAvailable(CaesarImplementation implementation) { // whether this CPU can run it
+    switch (implementation) {
+    case CAESAR_SCALAR:
+    case CAESAR_SWAR:
+        return TRUE;
+#ifdef CAESAR_X86_SIMD
+    case CAESAR_SSE2:
+        return boot_cpu_has(X86_FEATURE_XMM2);
+    case CAESAR_AVX2: // the CPU has to have it and the kernel has to save the ymm registers
+        return boot_cpu_has(X86_FEATURE_AVX2) && cpu_has_xfeatures(XFEATURE_MASK_SSE | XFEATURE_MASK_YMM, NULL);
+#endif
+    default:
+        return FALSE;
+    } // end switch
+}
+
+static unsigned int measureThroughput(CaesarImplementation implementation, CaesarTable const *table, char *buffer) { // MB/s over TRANSFORM_CHUNK_SIZE bytes, what the device passes at once
+    encodeStringWith(implementation, table, buffer, TRANSFORM_CHUNK_SIZE); // warms the caches up
+    u64 bytes = 0U;
+    preempt_disable(); // nothing else runs on this CPU in between, like the raid6 and xor benchmarks
+    u64 const start = ktime_get_ns();
+    u64 elapsed = 0U;
+    do {
+        encodeStringWith(implementation, table, buffer, TRANSFORM_CHUNK_SIZE);
+        bytes += TRANSFORM_CHUNK_SIZE;
+        elapsed = ktime_get_ns() - start;
+    } while (elapsed < BENCHMARK_NS);
+    preempt_enable();
+    return (unsigned int)div64_u64(bytes * 1000U, elapsed); // bytes per ns * 1000 == MB/s
+}
+
+int selectCaesarImplementation(void) { /* Measures every implementation this CPU can run for BENCHMARK_NS and lets encodeString and decodeString use the fastest,
+    * the numbers are kept for caesarImplementationThroughput. Different CPUs favour different ones, the widest is not always the fastest.
+    */
+    char *buffer = kmalloc(TRANSFORM_CHUNK_SIZE, GFP_KERNEL);
+    if (buffer == NULL) {
+        return -ENOMEM;
+    } // end if
+    for (size_t i = 0U; i < TRANSFORM_CHUNK_SIZE; ++i) { // mostly letters, some bytes outside of the alphabet
+        buffer[i] = (char)('A' + (i % 64U));
+    } // end for
+    CaesarTable table;
+    initCaesarTable(&table, CAESAR_ALPHABET, TRANS_OFFSET);
+    CaesarImplementation fastest = CAESAR_SCALAR;
+    for (int i = 0; i < CAESAR_IMPLEMENTATIONS; ++i) {
+        measuredThroughput[i] = caesarImplementationAvailable((CaesarImplementation)i) ? measureThroughput((CaesarImplementation)i, &table, buffer) : 0U;
+        if (measuredThroughput[i] > measuredThroughput[fastest]) {
+            fastest = (CaesarImplementation)i;
+        } // end if
+    } // end for
+    kfree(buffer);
+    WRITE_ONCE(selectedImplementation, fastest);
+    return EXIT_OK;
+} // end selectCaesarImplementation
+
+unsigned int caesarImplementationThroughput(CaesarImplementation implementation) { // as measured by selectCaesarImplementation, 0 if it was not
+    return measuredThroughput[implementation];
 }
 
-static void caesarString(char *string, // must be a valid C-String (zero terminated)
-                  size_t caesarOffset, BOOL encode) {
-    for (char *iter = string;
-         *iter != '\0';
-         ++iter) {
-        *iter = caesarChar(*iter, caesarOffset, encode);
-    }
+int findCaesarImplementation(char const *name) { // the implementation called name, a trailing newline (from sysfs) is ignored. -EINVAL for an unknown name.
+    size_t length = strlen(name);
+    if (length > 0U && name[length - 1U] == '\n') {
+        --length;
+    } // end if
+    for (int i = 0; i < CAESAR_IMPLEMENTATIONS; ++i) {
+        if (strlen(caesarImplementationNames[i]) == length && strncmp(caesarImplementationNames[i], name, length) == 0) {
+            return i;
+        } // end if
+    } // end for
+    return -EINVAL;
 }
 
-void encodeString(char *string, size_t incBy) {
-    caesarString(string, incBy, TRUE);
+int setCaesarImplementation(CaesarImplementation implementation) {
+    if ((int)implementation < 0 || implementation >= CAESAR_IMPLEMENTATIONS || !caesarImplementationAvailable(implementation)) {
+        return -EINVAL;
+    } // end if
+    WRITE_ONCE(selectedImplementation, implementation);
+    return EXIT_OK;
 }
 
-void decodeString(char *string, size_t decBy) {
-    caesarString(string, decBy, FALSE);
+CaesarImplementation getCaesarImplementation(void) {
+    return READ_ONCE(selectedImplementation);
 }
@@ -0,0 +1,3 @@
+#define CAESAR_VECTOR_BYTES 32
+#define CAESAR_VECTOR_FUNCTION  caesarShiftAvx2
+#include "CaesarVector.h"
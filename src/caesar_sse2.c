@@ -0,0 +1,3 @@
+#define CAESAR_VECTOR_BYTES 16
+#define CAESAR_VECTOR_FUNCTION  caesarShiftSse2
+#include "CaesarVector.h"
@@ -1,208 +1,706 @@
 #include "Device.h"
 
+#define CREATE_TRACE_POINTS /* the tracepoints are instantiated here, everywhere else Trace.h only declares them */
+#include "Trace.h"
+
 extern TransDevice *devices; // from module.c
-extern int *pTransOffset; // from module.c
+extern int numDevices; // from module.c
+extern char *alphabet; // from module.c
+extern int sharedMode; // from module.c
+extern int atomicWriteSize; // from module.c
+extern int sessionMode; // from module.c
+extern int legacyWakeups; // from module.c
+
+static struct kmem_cache *sessionCache = NULL; // the TransSessions of sessionMode
+static mempool_t *scratchPool = NULL; // the TransformScratch buffers of TRANS_IOC_TRANSFORM
+
+typedef struct { // what TRANS_IOC_TRANSFORM works with, taken from scratchPool per call
+    CaesarTable table;
+    int tableOffset; // the offset table was built for
+    BOOL tableValid;
+    char chunk[TRANSFORM_CHUNK_SIZE];
+} TransformScratch;
+
+typedef struct { // what an open allocates in sessionMode, one slab object
+    TransDevice device; // private_data of the struct file *
+    TransTable table; // the offset the device had when it was opened
+} TransSession;
+
+static size_t writeRoom(TransDevice *device) { /* How much free space makes the device writable: a record of up to atomicWriteSize bytes has to fit whole,
+    * like PIPE_BUF for a pipe. poll reports POLLOUT and writers are woken only from here on, so a nonblocking writer that poll called writable
+    * never gets -EAGAIN for a record.
+    */
+    return max_t(size_t, min_t(size_t, (size_t)atomicWriteSize, device->ring.capacity(&device->ring)), 1U);
+}
+
+static void wakeUpIfWaiting(TransDevice *device, BOOL writers) { /* A task only sleeps on readq after it saw the ring empty and only sleeps on writeq after it saw less than writeRoom free,
+    * so a sleeper exists only across an empty -> non-empty transition or one to at least writeRoom free. Everything else skips the wait queue lock.
+    */
+    if (legacyWakeups) { // the behaviour before readq and writeq were split, for comparisons: every sleeper wakes up and checks the ring again.
+        wake_up_all(&device->readq);
+        wake_up_all(&device->writeq);
+        return;
+    } // end if
+    wait_queue_head_t *queue = writers ? &device->writeq : &device->readq;
+    smp_mb(); // orders our update of the ring against the check for sleepers, pairs with the barrier in prepare_to_wait.
+    if (waitqueue_active(queue)) {
+        trace_trans_wake(device->minorNumber, writers, &device->ring);
+        wake_up(queue); // the waiters are exclusive, this wakes one of them.
+    } // end if
+}
+
+static void wakeWritersIfRoom(TransDevice *device) { // after bytes were consumed, writers are only woken once a whole record fits
+    if (legacyWakeups || device->ring.freeSpace(&device->ring) >= writeRoom(device)) {
+        wakeUpIfWaiting(device, TRUE);
+    } // end if
+}
+
+static void runCipher(TransDevice *device, TransTable const *table, char *span, size_t length) { // this device's direction of the cipher, in place
+    if (device->encoder) { // encode in place
+        encodeString(&table->caesar, span, length);
+    } /* end if encoder */ else {
+        /* Decoder */
+        decodeString(&table->caesar, span, length); // decode in place
+    } // end if decoder
+}
+
+static void transformSpan(TransDevice *device, char *span, size_t length) { /* runs the cipher over bytes a mapped producer published.
+    * Every chunk sees one whole table, an offset that changes meanwhile applies from the next chunk on.
+    */
+    while (length != 0U) {
+        size_t chunkLen = min(length, (size_t)TRANSFORM_CHUNK_SIZE); // keeps the read side critical sections short for a large mapped span.
+        rcu_read_lock();
+        runCipher(device, rcu_dereference(device->table), span, chunkLen);
+        rcu_read_unlock();
+        span += chunkLen;
+        length -= chunkLen;
+    } // end while
+}
+
+static void setMappedWaiting(TransDevice *device, BOOL writer, __u32 value) { // the flags in the control page, which a resize may replace once nothing maps it
+    rcu_read_lock();
+    TransRingControl *control = device->ring.control(&device->ring);
+    if (writer) {
+        WRITE_ONCE(control->writerWaiting, value);
+    } else {
+        WRITE_ONCE(control->readerWaiting, value);
+    } // end if
+    rcu_read_unlock();
+}
+
+static size_t transformMapped(TransDevice *device) { /* Runs the cipher over the bytes a mapped producer published and moves head past them.
+    * Readers, poll and the doorbell all call this, only one of them does the work under writeLock: whoever finds the lock taken
+    * leaves a request that the holder picks up before it leaves, so published bytes are never left behind.
+    */
+    size_t transformed = 0U;
+    u64 start = statsNow();
+    atomic_set(&device->transformRequested, 1);
+    smp_mb__after_atomic(); // pairs with the barrier after the unlock below.
+    while (mutex_trylock(&device->writeLock)) {
+        while (atomic_xchg(&device->transformRequested, 0) != 0) {
+            char *span = NULL;
+            size_t spanLen;
+            while ((spanLen = device->ring.reserveMapped(&device->ring, &span)) != 0U) { // at most two rounds, before and after the wrap.
+                transformSpan(device, span, spanLen);
+                device->ring.commitWrite(&device->ring, spanLen);
+                statsRecordQueued(&device->stats, device->ring.size(&device->ring));
+                transformed += spanLen;
+            } // end while
+        } // end while
+        mutex_unlock(&device->writeLock);
+        smp_mb(); // a request that was made while we held the lock is seen here.
+        if (atomic_read(&device->transformRequested) == 0) {
+            break;
+        } // end if
+    } // end while
+    if (transformed != 0U) {
+        statsRecordWrite(&device->stats, transformed, start);
+        wakeUpIfWaiting(device, FALSE);
+    } // end if
+    return transformed;
+}
+
+static void initSession(void *object) { /* the slab constructor, only runs when the cache gets a new page.
+    * A session is freed with its locks unlocked and its queues empty, so the next open can skip this.
+    */
+    TransSession *session = object;
+    mutex_init(&session->device.readLock);
+    mutex_init(&session->device.writeLock);
+    mutex_init(&session->device.configLock);
+    init_waitqueue_head(&session->device.readq);
+    init_waitqueue_head(&session->device.writeq);
+}
+
+int createSessionCache(void) {
+    sessionCache = kmem_cache_create("trans_session", sizeof(TransSession), 0, SLAB_HWCACHE_ALIGN, &initSession); // aligned, two sessions never share a cache line
+    if (sessionCache == NULL) {
+        PRINT_DEBUG("kmem_cache_create failed in %s\n", __FUNCTION__);
+        return -ENOMEM;
+    } // end if
+    return EXIT_OK;
+}
+
+void destroySessionCache(void) {
+    kmem_cache_destroy(sessionCache); // NULL is fine
+    sessionCache = NULL;
+}
+
+int createScratchPool(int reserved) { // reserved buffers are set aside now, TRANS_IOC_TRANSFORM can always get that many at once
+    scratchPool = mempool_create_kmalloc_pool(reserved, sizeof(TransformScratch));
+    if (scratchPool == NULL) {
+        PRINT_DEBUG("mempool_create_kmalloc_pool failed in %s\n", __FUNCTION__);
+        return -ENOMEM;
+    } // end if
+    return EXIT_OK;
+}
+
+void destroyScratchPool(void) {
+    mempool_destroy(scratchPool); // NULL is fine
+    scratchPool = NULL;
+}
+
+static int openSession(TransDevice *device, struct file *instance) { /* sessionMode: a queue of its own for this struct file *, with the capacity and the offset
+    * the device has right now. Nothing is shared with other opens but the statistics counters, so there is no -EBUSY and no lock contention between clients.
+    */
+    TransSession *session = kmem_cache_alloc(sessionCache, GFP_KERNEL);
+    if (session == NULL) {
+        return -ENOMEM;
+    } // end if
+    TransDevice *private = &session->device;
+    private->ring = createPrivateRingBuffer(device->ring.capacity(&device->ring)); // sessions are never mapped, no vmalloc area and control page per open
+    if (private->ring.capacity(&private->ring) == 0U) {
+        kmem_cache_free(sessionCache, session);
+        return -ENOMEM;
+    } // end if
+    rcu_read_lock();
+    session->table = *rcu_dereference(device->table);
+    rcu_read_unlock();
+    RCU_INIT_POINTER(private->table, &session->table); // never replaced, the sysfs attributes belong to the device
+    private->stats = device->stats; // the counters of the device, /proc/translate shows all sessions of a device together
+    private->stats.highWaterMark = 0U;
+    private->readers = (instance->f_mode & FMODE_READ) ? 1 : 0;
+    private->writers = (instance->f_mode & FMODE_WRITE) ? 1 : 0;
+    private->minorNumber = device->minorNumber;
+    private->encoder = device->encoder;
+    private->session = TRUE;
+    atomic_set(&private->mappings, 0);
+    atomic_set(&private->transformRequested, 0);
+    instance->private_data = private;
+    return EXIT_OK;
+}
+
+static void closeSession(TransDevice *private) {
+    private->ring.destructor(&private->ring);
+    kmem_cache_free(sessionCache, container_of(private, TransSession, device));
+}
 
 int transDeviceOpen(struct inode *deviceFile,
                        struct file *instance) { // called when a process opens the device
-    PRINT_DEBUG("transDeviceOpen called\n");
-    
     int minorNumber = MINOR(deviceFile->i_rdev); // extract the minor device number
+    if (minorNumber >= numDevices) { // the major covers all 256 minors, only the first numDevices exist.
+        return -ENODEV;
+    } // end if
     TransDevice *device = &devices[minorNumber];
-    device->minorNumber = minorNumber; // let the device know which minor device number it has
+    if (sessionMode) { // write to and read from the same file, e.g. open with O_RDWR.
+        int retVal = openSession(device, instance);
+        if (retVal == EXIT_OK) {
+            nonseekable_open(deviceFile, instance);
+        } // end if
+        trace_trans_open(minorNumber, instance->f_mode, retVal);
+        return retVal;
+    } // end if
     instance->private_data = device; // save a pointer to the TransDevice struct in the struct file *
     
     if (instance->f_mode & FMODE_WRITE) { // opened in write mode
-        PRINT_DEBUG("%s: write mode device: %d\n", __FUNCTION__, minorNumber);
-        if (device->writers != 0) {
-            PRINT_DEBUG("%s: writers != 0, got -EBUSY device: %d\n", __FUNCTION__, minorNumber);
-            return -EBUSY; // you can't write if another process is already writing.
+        if (device->writers != 0 && !sharedMode) {
+            trace_trans_open(minorNumber, instance->f_mode, -EBUSY);
+            statsRecordBusy(&device->stats);
+            return -EBUSY; // you can't write if another process is already writing, unless the module was loaded with sharedMode=1.
         } // end if
         ++device->writers;
-        PRINT_DEBUG("%s: incremented writers device: %d\n", __FUNCTION__, minorNumber);
     } // end if
     
     if (instance->f_mode & FMODE_READ) { // opened in read mode
-        PRINT_DEBUG("%s: read mode device: %d\n", __FUNCTION__, minorNumber);
-        if (device->readers != 0) {
-            PRINT_DEBUG("%s: readers != 0, got -EBUSY device: %d\n", __FUNCTION__, minorNumber);
-            return -EBUSY; // you can't read if another process is already reading.
+        if (device->readers != 0 && !sharedMode) {
+            trace_trans_open(minorNumber, instance->f_mode, -EBUSY);
+            statsRecordBusy(&device->stats);
+            return -EBUSY; // you can't read if another process is already reading, unless the module was loaded with sharedMode=1.
         } // end if
         ++device->readers;
-        PRINT_DEBUG("%s: incremented readers device: %d\n", __FUNCTION__, minorNumber);
     } // end if
     
     nonseekable_open(deviceFile, instance); // no seeking!
-    PRINT_DEBUG("device: %d exited %s successfully.\n", minorNumber, __FUNCTION__);
+    trace_trans_open(minorNumber, instance->f_mode, EXIT_OK);
     return EXIT_OK;
 } // end transDeviceOpen
 
 int transDeviceClose(struct inode *deviceFile,
                        struct file *instance) { // called when a process closes its connection to the device.
-    PRINT_DEBUG("transDeviceClose called\n");
     TransDevice *device = instance->private_data; // get a pointer to the TransDevice we stored.
     
     if (instance->f_mode & FMODE_WRITE) {
-        PRINT_DEBUG("device %d in %s: decrementing writers\n", device->minorNumber, __FUNCTION__);
         --device->writers;
     } // end if
     
     if (instance->f_mode & FMODE_READ) {
-        PRINT_DEBUG("device %d in %s: decrementing readers\n", device->minorNumber, __FUNCTION__);
         --device->readers;
     } // end if   
-    PRINT_DEBUG("device %d: exited %s successfully. String capacity: %u\n", device->minorNumber, __FUNCTION__, device->string.capacity(&device->string));
+    trace_trans_close(device->minorNumber, instance->f_mode, EXIT_OK);
+    if (device->session) { // nobody else has it, whatever is still queued is dropped.
+        closeSession(device);
+    } // end if
     return EXIT_OK;
 } // end transDeviceClose
 
-ssize_t transDeviceWrite(struct file *filp,
-                         char const __user *buf,
-                         size_t count, loff_t *offs) { // called when a process writes to the device.
-    PRINT_DEBUG("%s called.\n", __FUNCTION__);
+static ssize_t writeToDevice(TransDevice *device, struct file *filp,
+                             struct iov_iter *from) { /* Streams all segments of the user buffer (one for write, many for writev) through the ring in chunks of
+    * at most WRITE_CHUNK_SIZE bytes, waiting for a reader whenever the ring is full. A chunk may span several segments,
+    * so many small records cost one lock acquisition and one pass through the caesar table. Nothing is allocated, however large count is.
+    * A write of at most atomicWriteSize bytes is a record: it waits until all of it fits and is published at once,
+    * so it is never interleaved with other writers and a reader never sees a part of it. In sharedMode larger writes may be interleaved where they had to wait,
+    * otherwise the lock is kept while sleeping and a write stays contiguous even against threads sharing the struct file *.
+    */
+    size_t count = iov_iter_count(from);
     if (count == 0U) {
         return count;
     }
-    char *fromUser = HEAP_ALLOC8(sizeof(char) * (count + 1)); // we will store the raw input from the user here. +1 for the '\0', we would like this to be a properly formed string.
-    if (fromUser == NULL) { // heap allocation failed.
-        PRINT_DEBUG("ERROR: no memory for fromUser in transDeviceWrite\n");
-        return -ENOMEM; // not enough memory :(
-    } // end if
     
-    TransDevice *device = filp->private_data; // get a pointer to the TransDevice
-    PRINT_DEBUG("device %d in %s trying to acquire semaphore, line: %d\n", device->minorNumber, __FUNCTION__, __LINE__);
-    int retVal = down_interruptible(&device->sem); /*
-    * down_interruptible - acquire the semaphore unless interrupted
-    *
-    * Attempts to acquire the semaphore.  If no more tasks are allowed to
-    * acquire the semaphore, calling this function will put the task to sleep.
-    * If the sleep is interrupted by a signal, this function will return -EINTR.
-    * If the semaphore is successfully acquired, this function returns 0.
+    int retVal = mutex_lock_interruptible(&device->writeLock); /* The reader never takes this lock, the ring buffer is lock free between one producer and one consumer.
+    * The lock serializes the tasks that write to this device, several of them in sharedMode, otherwise the ones sharing the writing struct file * (threads, fork).
     */
-    PRINT_DEBUG("device %d in %s got the semaphore, line %d\n", device->minorNumber, __FUNCTION__, __LINE__);
     if (retVal != 0) { /* if process woke up from signal */
-        PRINT_DEBUG("device %d in %s woke up from signal in line %d\n", device->minorNumber, __FUNCTION__, __LINE__);
         return -ERESTARTSYS; // try again if you can
     } // end if
-    while (device->string.size(&device->string) >= device->maxBufSize) { // if full -> we have to wait, because there is no more room in the buffer. Someone has to read something first.
-        PRINT_DEBUG("device %d in %s: my buffer is full!\n", device->minorNumber, __FUNCTION__);
-        up(&device->sem); // release semaphore
-        PRINT_DEBUG("device %d in %s in line %d: releasing semaphore, waiting until my buffer is no longer full\n", device->minorNumber, __FUNCTION__, __LINE__);
-        retVal = wait_event_interruptible(device->q, device->string.size(&device->string) < device->maxBufSize); // go into the wait queue and wait until the condition is true.
-        if (retVal != 0) { /* if process woke up from signal */
-            PRINT_DEBUG("device %d in %s woke up from signal in line %d\n", device->minorNumber, __FUNCTION__, __LINE__);
-            return -ERESTARTSYS;
+    if (atomic_read(&device->mappings) != 0) { // the mapping is the producer, our bytes would end up in the middle of its stream.
+        mutex_unlock(&device->writeLock);
+        trace_trans_write(device->minorNumber, count, -EBUSY, &device->ring);
+        return -EBUSY;
+    } // end if
+
+    size_t bytesWritten = 0U;
+    int error = EXIT_OK; // why we stopped before all count bytes were written
+    BOOL locked = TRUE;
+    while (bytesWritten < count) {
+        BOOL record = bytesWritten == 0U && count <= (size_t)atomicWriteSize && count <= device->ring.capacity(&device->ring); // all or nothing
+        size_t needed = record ? count : 1U;
+        if (device->ring.freeSpace(&device->ring) < needed) { // we have to wait, because there is not enough room in the buffer. Someone has to read something first.
+            if (filp->f_flags & O_NONBLOCK) { // the caller does not want to sleep, it will come back when poll reports POLLOUT.
+                error = -EAGAIN;
+                break;
+            } // end if
+            if (sharedMode) { // the other writers go on while we sleep, a resize may happen too.
+                mutex_unlock(&device->writeLock);
+                locked = FALSE;
+            } // end if
+            trace_trans_block(device->minorNumber, TRUE, &device->ring);
+            u64 blockedSince = statsNow();
+            retVal = wait_event_interruptible_exclusive(device->writeq, device->ring.freeSpace(&device->ring) >= needed
+                                                                         || device->ring.capacity(&device->ring) < needed); // The reader does not need our lock to make room.
+            statsRecordBlocked(&device->stats, TRUE, blockedSince);
+            if (retVal != 0) { /* if process woke up from signal */
+                error = -ERESTARTSYS;
+                break;
+            } // end if
+            if (!locked) {
+                if (mutex_lock_interruptible(&device->writeLock) != 0) {
+                    error = -ERESTARTSYS;
+                    break;
+                } // end if
+                locked = TRUE;
+                if (atomic_read(&device->mappings) != 0) { // mapped while we did not hold the lock
+                    error = -EBUSY;
+                    break;
+                } // end if
+            } // end if
+            continue; // another writer may have taken the space again, look at the ring again.
         } // end if
-        PRINT_DEBUG("device %d in %s: trying to acquire semaphore, line: %d\n", device->minorNumber, __FUNCTION__, __LINE__);
-        retVal = down_interruptible(&device->sem); // acquire the semaphore
-        PRINT_DEBUG("device %d in %s: got semaphore in line %d\n", device->minorNumber, __FUNCTION__, __LINE__);
-        if (retVal != 0) { /* if process woke up from signal */
-            PRINT_DEBUG("device %d in %s woke up from signal in line %d\n", device->minorNumber, __FUNCTION__, __LINE__);
-            return -ERESTARTSYS;
+        
+        size_t want = record ? count : min(count - bytesWritten, (size_t)WRITE_CHUNK_SIZE); /* at most one chunk of a stream.
+            Bytes that do not fit yet are not copied until there is room for them. */
+        size_t reserved = 0U;
+        char *spans[2]; // the contiguous free space after the head and the part that wraps around
+        size_t spanLens[2];
+        int spanCount = 0;
+        while (reserved < want && spanCount < (int)COUNTOF(spans)) {
+            char *span = NULL;
+            size_t spanLen = device->ring.reserveWriteAfter(&device->ring, &span, reserved, want - reserved);
+            if (spanLen == 0U) {
+                break;
+            } // end if
+            size_t copied = copy_from_iter(span, spanLen, from); // copy straight into the free part of the ring, gathering across segment boundaries. Advances the iterator.
+            spans[spanCount] = span;
+            spanLens[spanCount++] = copied;
+            reserved += copied;
+            if (copied != spanLen) { // only the part that was copied gets committed, the reader never sees the bytes that faulted.
+                PRINT_DEBUG("ERROR: device %d in %s copy_from_iter copied %zu of %zu bytes\n", device->minorNumber, __FUNCTION__, copied, spanLen);
+                error = -EFAULT;
+                break;
+            } // end if
+        } // end while
+        if (record && error != EXIT_OK) { // a record goes in whole or not at all
+            reserved = 0U;
         } // end if
-    } // end while buffer full
-
-    size_t howMuchToAppend = min(count - 1U, (size_t)(device->maxBufSize - device->string.size(&device->string))); /* We either copy as much as the user
-        wants (in characters), or we copy as much as we can still hold. device->maxBufSize is the maximum size, subtracting the current size is the remaining capacity
-        */
-    
-    BOOL returnCount = FALSE;
-    if (howMuchToAppend == (count - 1U)) {
-        returnCount = TRUE;
-    }
-   
-    retVal = copy_from_user(fromUser, // copy in here
-                            buf, /* from parameter list */
-                            count // that many bytes
-                           ); // Returns number of bytes that could not be copied. On success, this will be zero.
-    
-    fromUser[howMuchToAppend] = '\0'; // shorten the string so we copy only as much as we can.                
-    if (device->minorNumber == 0) { // encode        
-        encodeString(fromUser, *pTransOffset); // encode the string
-        PRINT_DEBUG("device %d in %s encoded the string to: %s\n", device->minorNumber, __FUNCTION__, fromUser);
-    } /* end if device 0 (encoder) */ else {
-        /* Device 1 (Decoder) */
-        decodeString(fromUser, *pTransOffset); // decode the string, that we got from user
-        PRINT_DEBUG("device %d in %s decoded the string to: %s\n", device->minorNumber, __FUNCTION__, fromUser);
-    } // end if device 1
+        if (reserved != 0U) { // copy_from_iter may sleep, so all spans are copied first and then encoded or decoded with one table: a record never mixes two offsets.
+            rcu_read_lock();
+            TransTable const *table = rcu_dereference(device->table);
+            for (int i = 0; i < spanCount; ++i) {
+                runCipher(device, table, spans[i], spanLens[i]);
+            } // end for
+            rcu_read_unlock();
+        } // end if
+        
+        device->ring.commitWrite(&device->ring, reserved); // this publishes the bytes to the reader.
+        bytesWritten += reserved;
+        if (reserved != 0U) {
+            statsRecordQueued(&device->stats, device->ring.size(&device->ring));
+            wakeUpIfWaiting(device, FALSE); // let a waiting reader drain this chunk while we produce the next one.
+        } // end if
+        if (error != EXIT_OK) {
+            break;
+        } // end if
+    } // end while
+    if (locked) {
+        mutex_unlock(&device->writeLock);
+    } // end if
+    wakeWritersIfRoom(device); // the reader woke only us, pass it on if there is room left for another writer.
+    if (atomic_read(&device->transformRequested) != 0) { // a mapping was set up while we streamed, its bytes may wait for the lock we just released.
+        transformMapped(device);
+    } // end if
     
-    device->string.append(&device->string, fromUser); // append to the device's buffer
-    PRINT_DEBUG("device %d in %s appended string to my buffer here is my buffer %s\n", device->minorNumber, __FUNCTION__, device->string.data(&device->string));    
-    up(&device->sem); // release semaphore
-    PRINT_DEBUG("device %d in %s released semaphore in line %d\n", device->minorNumber, __FUNCTION__, __LINE__);
-    wake_up(&device->q); // wake up those that wait in the queue 
-    kfree(fromUser);
-    PRINT_DEBUG("device %d exited %s with count %u howMuchToAppend: %u\n", device->minorNumber, __FUNCTION__, count, howMuchToAppend);
-    size_t bytesWritten = 0U;
-    if (returnCount) {
-        bytesWritten = count;
-    } else {
-        bytesWritten = howMuchToAppend;
-    }
+    if (bytesWritten == 0U) { // report the error only if nothing was written, otherwise the caller gets a short count and sees the error on its next call.
+        trace_trans_write(device->minorNumber, count, error, &device->ring);
+        return error;
+    } // end if
+    trace_trans_write(device->minorNumber, count, bytesWritten, &device->ring);
     return bytesWritten; // return how many bytes were actually written
+} /* end writeToDevice */
+
+ssize_t transDeviceWrite(struct kiocb *iocb,
+                         struct iov_iter *from) { // called when a process writes to the device with write or writev.
+    struct file *filp = iocb->ki_filp;
+    TransDevice *device = filp->private_data; // get a pointer to the TransDevice
+    u64 start = statsNow();
+    ssize_t result = writeToDevice(device, filp, from);
+    statsRecordWrite(&device->stats, result, start);
+    return result;
 } /* end transDeviceWrite */
 
-ssize_t transDeviceRead(struct file *instance,
-                          char *user, size_t count,
-                          loff_t *offset) { // called when a process reads from the device.
-    PRINT_DEBUG("%s called\n", __FUNCTION__);
+static ssize_t readFromDevice(TransDevice *device, struct file *instance,
+                              struct iov_iter *to) { /* Copies straight out of the ring into the user buffer (one segment for read, many for readv),
+    * scattering across segment boundaries under a single lock acquisition: the bytes are claimed with reserveRead,
+    * copied and only then handed back to the writer with commitRead. The writer never takes readLock, so a page fault on the user buffer
+    * only delays other readers of this device, never the writer.
+    */
     int errorCode;
-    TransDevice *device = NULL;
-    device = instance->private_data; // get the pointer to the TransDevice.
-    char *toUser = HEAP_ALLOC8(sizeof(char) * (count + 1U)); // this is where we will put the stuff we want to copy to user space. +1 because if we need to copy the entire buffer, which is count large at the most, we still want to form a valid C-String and need one more byte for '\0'.
-    if (toUser == NULL) {
-        PRINT_DEBUG("ERROR: no memory for toUser in transDeviceRead\n");
-        return -ENOMEM;
+    size_t count = iov_iter_count(to);
+    if (count == 0U) {
+        return count;
     } // end if
-    PRINT_DEBUG("device %d in %s trying to acquire semaphore in line %d\n", device->minorNumber, __FUNCTION__, __LINE__);
-    errorCode = down_interruptible(&device->sem); // acquire the semaphore
-    PRINT_DEBUG("device %d in %s got semaphore in line %d\n", device->minorNumber, __FUNCTION__, __LINE__);
+    errorCode = mutex_lock_interruptible(&device->readLock); // the writer never takes this lock, see transDeviceWrite.
     if (errorCode != 0) {
-        PRINT_DEBUG("device %d in %s woke up from signal in line %d\n", device->minorNumber, __FUNCTION__, __LINE__);
         return -ERESTARTSYS;
     } // end if
-    
-    while (device->string.isEmpty(&device->string)) { // if this device's buffer is empty the process cannot read from it it must wait until there is something to read.
-        PRINT_DEBUG("device %d in %s line %d: my buffer is empty\n", device->minorNumber, __FUNCTION__, __LINE__);
-        up(&device->sem); /* release the semaphore */
-        PRINT_DEBUG("device %d in %s line %d: released semaphore\n", device->minorNumber, __FUNCTION__, __LINE__);
-        errorCode = wait_event_interruptible(device->q, !device->string.isEmpty(&device->string)); // go into the waitqueue
-        PRINT_DEBUG("device %d in %s my buffer is no longer empty (or i got a signal).\n", device->minorNumber, __FUNCTION__);
+    BOOL mapped = atomic_read(&device->mappings) != 0;
+    if (mapped) { // the producer does not ring the doorbell while we are awake, pick up what it published.
+        transformMapped(device);
+    } // end if
+    while (device->ring.isEmpty(&device->ring)) { // if this device's buffer is empty the process cannot read from it it must wait until there is something to read.
+        if (instance->f_flags & O_NONBLOCK) { // the caller does not want to sleep, it will come back when poll reports POLLIN.
+            mutex_unlock(&device->readLock);
+            trace_trans_read(device->minorNumber, count, -EAGAIN, &device->ring);
+            return -EAGAIN;
+        } // end if
+        mutex_unlock(&device->readLock); // other readers may go on while we sleep, a resize may happen too.
+        trace_trans_block(device->minorNumber, FALSE, &device->ring);
+        u64 blockedSince = statsNow();
+        setMappedWaiting(device, FALSE, 1U); // a mapped producer rings the doorbell from now on.
+        smp_mb(); // pairs with the barrier between the producer's store to produced and its check of readerWaiting.
+        if (mapped) { // whatever was published before the producer could see the flag.
+            transformMapped(device);
+        } // end if
+        errorCode = wait_event_interruptible_exclusive(device->readq, !device->ring.isEmpty(&device->ring)); // one record wakes one reader
+        setMappedWaiting(device, FALSE, 0U);
+        statsRecordBlocked(&device->stats, FALSE, blockedSince);
         if (errorCode != 0) {
-            PRINT_DEBUG("device %d in %s woke up from signal in line %d\n", device->minorNumber, __FUNCTION__, __LINE__);
             return -ERESTARTSYS;
         } // end if
-        PRINT_DEBUG("device %d in %s trying to acquire semaphore in line %d\n", device->minorNumber, __FUNCTION__, __LINE__);
-        errorCode = down_interruptible(&device->sem); // wait for semaphore (try to acquire it).
-        PRINT_DEBUG("device %d in %s got semaphore in line %d\n", device->minorNumber, __FUNCTION__, __LINE__);
-        if (errorCode != 0) {
-            PRINT_DEBUG("device %d in %s woke up from signal in line %d\n", device->minorNumber, __FUNCTION__, __LINE__);
+        if (mutex_lock_interruptible(&device->readLock) != 0) {
+            if (!device->ring.isEmpty(&device->ring)) { // the writer may have woken only us, pass it on or the other readers sleep next to queued bytes.
+                wakeUpIfWaiting(device, FALSE);
+            } // end if
             return -ERESTARTSYS;
-        } // end if        
-    } // end while buffer empty
+        } // end if
+        mapped = atomic_read(&device->mappings) != 0;
+    } // end while, another reader may have been faster
     
-    PRINT_DEBUG("device %d in %s line %d count is %u\n", device->minorNumber, __FUNCTION__, __LINE__, count);
-    count = min(count, device->string.size(&device->string) + 1U); // read as much as the user wants, or if we don't have that much read as much as we've got.
-    PRINT_DEBUG("device %d in %s line %d count is %u\n", device->minorNumber, __FUNCTION__, __LINE__, count);   
-    device->string.toBuffer(&device->string, toUser, count + 1U);
-    PRINT_DEBUG("device %d in %s line %d copied %s to the toUser buffer\n", device->minorNumber, __FUNCTION__, __LINE__, toUser);
-    for (size_t i = 0U; i < (count - 1U); ++i) {
-        device->string.popFront(&device->string); // remove as many elements from the string as we copied to the user.
-    }
-    PRINT_DEBUG("device %d in %s popped stuff from the front of my string, it now looks like this: %s\n", device->minorNumber, __FUNCTION__, device->string.data(&device->string));
+    size_t bytesRead = 0U;
+    BOOL faulted = FALSE;
+    while (bytesRead < count) { // at most two rounds: the part before the end of the storage and the part that wrapped around.
+        char const *span = NULL;
+        size_t spanLen = device->ring.reserveRead(&device->ring, &span, count - bytesRead);
+        if (spanLen == 0U) { // read as much as the user wants, or if we don't have that much read as much as we've got.
+            break;
+        } // end if
+        size_t copied = copy_to_iter(span, spanLen, to); // may fault, the writer keeps producing meanwhile. Advances the iterator.
+        device->ring.commitRead(&device->ring, copied); // bytes that did not reach the user stay queued for the next read.
+        bytesRead += copied;
+        if (copied != spanLen) {
+            PRINT_DEBUG("ERROR: device %d in %s copy_to_iter copied %zu of %zu bytes\n", device->minorNumber, __FUNCTION__, copied, spanLen);
+            faulted = TRUE;
+            break;
+        } // end if
+    } // end while
+    mutex_unlock(&device->readLock);
+    if (bytesRead != 0U) {
+        wakeWritersIfRoom(device); // the space is free now, wake a writer that waits for it.
+    } // end if
+    if (!device->ring.isEmpty(&device->ring)) { // the writer woke only us, pass it on if there is something left for another reader.
+        wakeUpIfWaiting(device, FALSE);
+    } // end if
     
-    int retCode = copy_to_user(user, // copy to user space
-                               toUser, // copy from this buffer
-                               count); // this amount of elements
-    PRINT_DEBUG("device %d in %s copied the data to user space\n", device->minorNumber, __FUNCTION__);
-    if (retCode != 0) {
-        PRINT_DEBUG("ERROR: device %d in %s in line %d copy_to_user failed with %d\n", device->minorNumber, __FUNCTION__, __LINE__, retCode);
+    if (bytesRead == 0U && faulted) { // a short count if some bytes made it, the caller sees the fault on its next call.
+        trace_trans_read(device->minorNumber, count, -EFAULT, &device->ring);
         return -EFAULT;
-    }    
-            
-    up(&device->sem); // release semaphore
-    PRINT_DEBUG("device %d in %s in line %d: released semaphore\n", device->minorNumber, __FUNCTION__, __LINE__);
-    wake_up(&device->q); // wake those that sleep in queue 
-    kfree(toUser); // release that buffer we used.
-    PRINT_DEBUG("device %d exiting %s with count: %u\n", device->minorNumber, __FUNCTION__, count);
-    return count; // return how many bytes where actually read.
+    } // end if
+    trace_trans_read(device->minorNumber, count, bytesRead, &device->ring);
+    return bytesRead; // return how many bytes where actually read.
+} // end readFromDevice
+
+ssize_t transDeviceRead(struct kiocb *iocb,
+                        struct iov_iter *to) { // called when a process reads from the device with read or readv.
+    struct file *instance = iocb->ki_filp;
+    TransDevice *device = instance->private_data; // get the pointer to the TransDevice.
+    u64 start = statsNow();
+    ssize_t result = readFromDevice(device, instance, to);
+    statsRecordRead(&device->stats, result, start);
+    return result;
 } // end transDeviceRead
+
+__poll_t transDevicePoll(struct file *instance,
+                         poll_table *wait) { // called by poll, select and epoll to find out whether a read or a write would block.
+    TransDevice *device = instance->private_data;
+    __poll_t mask = 0;
+    
+    BOOL mapped = atomic_read(&device->mappings) != 0;
+    
+    poll_wait(instance, &device->readq, wait); // woken up when data arrives
+    poll_wait(instance, &device->writeq, wait); // woken up when space is freed
+    if (mapped) { /* Raise both flags before looking, then the other side of the mapping either sees them and rings the doorbell
+        * or we see what it did. The flag of a direction that is ready is taken back below.
+        */
+        setMappedWaiting(device, FALSE, 1U);
+        setMappedWaiting(device, TRUE, 1U);
+        smp_mb();
+        transformMapped(device);
+    } // end if
+    if (!device->ring.isEmpty(&device->ring)) {
+        mask |= POLLIN | POLLRDNORM; // readable
+        if (mapped) {
+            setMappedWaiting(device, FALSE, 0U);
+        } // end if
+    } // end if
+    if (device->ring.freeSpace(&device->ring) >= writeRoom(device)) {
+        mask |= POLLOUT | POLLWRNORM; // writable, a record of up to atomicWriteSize bytes fits
+        if (mapped) {
+            setMappedWaiting(device, TRUE, 0U);
+        } // end if
+    } // end if
+    return mask;
+} // end transDevicePoll
+
+static void transVmaOpen(struct vm_area_struct *vma) { // the mapping was copied or split
+    TransDevice *device = vma->vm_private_data;
+    atomic_inc(&device->mappings);
+}
+
+static void transVmaClose(struct vm_area_struct *vma) {
+    TransDevice *device = vma->vm_private_data;
+    atomic_dec(&device->mappings);
+}
+
+static struct vm_operations_struct const transVmOps = {
+    .open = &transVmaOpen,
+    .close = &transVmaClose,
+};
+
+int transDeviceMmap(struct file *instance,
+                    struct vm_area_struct *vma) { // maps the control page and the ring storage, see TransIoctl.h for the protocol.
+    TransDevice *device = instance->private_data;
+    if ((instance->f_mode & (FMODE_READ | FMODE_WRITE)) != (FMODE_READ | FMODE_WRITE)) { /* the mapping is the producer, so the file has to be the writer.
+        * The VFS already refuses a shared mapping of a file without FMODE_READ, so only an O_RDWR file gets here: it holds the reader slot as well,
+        * the bytes have to be consumed through the same file (read, poll or the mapping), by the same process or one it shares the file with.
+        */
+        return -EACCES;
+    } // end if
+    if (sharedMode || device->session) { // the waiting flags in the control page are made for one reader and one producer, a session is not worth mapping.
+        return -EOPNOTSUPP;
+    } // end if
+    if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start > device->ring.mapSize(&device->ring)) {
+        return -EINVAL;
+    } // end if
+    if (mutex_lock_interruptible(&device->writeLock) != 0) { // no write may be streaming while the producer changes.
+        return -ERESTARTSYS;
+    } // end if
+    TransRingControl *control = device->ring.control(&device->ring);
+    int retVal = remap_vmalloc_range(vma, control, 0);
+    if (retVal == 0) {
+        vma->vm_ops = &transVmOps;
+        vma->vm_private_data = device;
+        if (atomic_inc_return(&device->mappings) == 1) { // a new producer starts where the ring is, nothing is pending.
+            WRITE_ONCE(control->produced, control->head);
+        } // end if
+    } // end if
+    mutex_unlock(&device->writeLock);
+    return retVal;
+} // end transDeviceMmap
+
+static long transformSegment(TransformScratch *scratch, TransTransformSegment const *segment) { // returns the bytes done or a negative error
+    if (segment->direction != TRANS_ENCODE && segment->direction != TRANS_DECODE) {
+        return -EINVAL;
+    } // end if
+    if (!scratch->tableValid || scratch->tableOffset != segment->offset) { // consecutive segments usually share their offset
+        initCaesarTable(&scratch->table, alphabet, segment->offset);
+        scratch->tableOffset = segment->offset;
+        scratch->tableValid = TRUE;
+    } // end if
+    
+    char __user *user = (char __user *)(uintptr_t)segment->data;
+    u64 done = 0U;
+    while (done < segment->length) {
+        size_t chunkLen = (size_t)min_t(u64, segment->length - done, TRANSFORM_CHUNK_SIZE);
+        if (copy_from_user(scratch->chunk, user + done, chunkLen) != 0) {
+            return -EFAULT;
+        } // end if
+        if (segment->direction == TRANS_ENCODE) {
+            encodeString(&scratch->table, scratch->chunk, chunkLen);
+        } else {
+            decodeString(&scratch->table, scratch->chunk, chunkLen);
+        } // end if
+        if (copy_to_user(user + done, scratch->chunk, chunkLen) != 0) {
+            return -EFAULT;
+        } // end if
+        done += chunkLen;
+        if (fatal_signal_pending(current)) { // a huge segment must not keep a killed task in here.
+            return -EINTR;
+        } // end if
+        cond_resched();
+    } // end while
+    return (long)done;
+}
+
+static long transformUser(void __user *argument) { /* TRANS_IOC_TRANSFORM: translates user memory in place, chunk by chunk through a scratch buffer.
+    * Neither the ring nor any lock of the device is touched, concurrent callers share nothing but the alphabet.
+    * Stops after INT_MAX bytes, ioctl returns an int to user space and a larger count would be cut off there.
+    */
+    TransTransformRequest request;
+    if (copy_from_user(&request, argument, sizeof(request)) != 0) {
+        return -EFAULT;
+    } // end if
+    if (request.count > TRANS_TRANSFORM_MAX_SEGMENTS || request.reserved != 0U) {
+        return -EINVAL;
+    } // end if
+    TransformScratch *scratch = mempool_alloc(scratchPool, GFP_KERNEL); // never fails, if memory is tight it waits for a reserved buffer to come back.
+    scratch->tableValid = FALSE;
+    
+    TransTransformSegment __user *segments = (TransTransformSegment __user *)(uintptr_t)request.segments;
+    long total = 0;
+    for (u32 i = 0U; i < request.count; ++i) {
+        TransTransformSegment segment;
+        if (copy_from_user(&segment, &segments[i], sizeof(segment)) != 0) {
+            total = -EFAULT;
+            break;
+        } // end if
+        segment.length = min_t(u64, segment.length, (u64)(INT_MAX - total)); // the rest is left for the next call
+        long done = transformSegment(scratch, &segment);
+        if (done < 0) {
+            total = done;
+            break;
+        } // end if
+        total += done;
+        if (total == INT_MAX) {
+            break;
+        } // end if
+    } // end for
+    mempool_free(scratch, scratchPool);
+    return total;
+}
+
+long transDeviceIoctl(struct file *instance,
+                      unsigned int command,
+                      unsigned long argument) {
+    TransDevice *device = instance->private_data;
+    switch (command) {
+    case TRANS_IOC_DOORBELL: { // a side of the mapping made progress while the other one was asleep
+        long transformed = 0;
+        if (atomic_read(&device->mappings) != 0) {
+            transformed = (long)transformMapped(device); // wakes a reader if there is something new
+        } // end if
+        wakeWritersIfRoom(device); // a mapped consumer may have made room
+        return transformed;
+    }
+    case TRANS_IOC_MAP_SIZE:
+        return (long)device->ring.mapSize(&device->ring);
+    case TRANS_IOC_TRANSFORM:
+        return transformUser((void __user *)argument);
+    default:
+        return -ENOTTY;
+    } // end switch
+} // end transDeviceIoctl
+
+int transDeviceOffset(TransDevice *device) {
+    rcu_read_lock();
+    int offset = rcu_dereference(device->table)->offset;
+    rcu_read_unlock();
+    return offset;
+}
+
+int transDeviceSetOffset(TransDevice *device, int offset) { /* Builds the tables for offset aside and publishes them with one pointer store. A record, or a chunk of a longer write
+    * or of a mapped span, keeps using the tables it started with: the offset only changes between the chunks of a longer write.
+    * Only this device changes, set both devices of a pair so that the decoder still undoes the encoder.
+    */
+    TransTable *table = kmalloc(sizeof(*table), GFP_KERNEL);
+    if (table == NULL) {
+        return -ENOMEM;
+    } // end if
+    table->offset = offset;
+    initCaesarTable(&table->caesar, alphabet, offset);
+    mutex_lock(&device->configLock);
+    TransTable *old = rcu_dereference_protected(device->table, lockdep_is_held(&device->configLock));
+    rcu_assign_pointer(device->table, table);
+    mutex_unlock(&device->configLock);
+    if (old != NULL) { // NULL when moduleInit sets the first offset
+        kfree_rcu(old, rcu); // freed once no chunk can use it any more
+    } // end if
+    return EXIT_OK;
+}
+
+int transDeviceResize(TransDevice *device, size_t capacity) { /* Moves the queued bytes into a ring of the new capacity, the open files keep working.
+    * Readers do not hold their lock while they sleep and neither do writers in sharedMode, so this waits for a read or write call at most.
+    * Otherwise a writer that sleeps for room keeps writeLock, the resize then waits until a reader made room for it or a signal interrupts it.
+    * Fails with -EBUSY while the ring is mapped and with -ENOSPC if more bytes are queued than fit.
+    */
+    if (mutex_lock_interruptible(&device->configLock) != 0) {
+        return -ERESTARTSYS;
+    } // end if
+    int retVal = mutex_lock_interruptible(&device->writeLock);
+    if (retVal == 0) {
+        retVal = mutex_lock_interruptible(&device->readLock);
+        if (retVal == 0) {
+            if (atomic_read(&device->mappings) != 0) { // user space has the old storage mapped
+                retVal = -EBUSY;
+            } else {
+                retVal = device->ring.resize(&device->ring, capacity);
+            } // end if
+            mutex_unlock(&device->readLock);
+        } else {
+            retVal = -ERESTARTSYS;
+        } // end if
+        mutex_unlock(&device->writeLock);
+    } else {
+        retVal = -ERESTARTSYS;
+    } // end if
+    wake_up_all(&device->readq); // they all look at the new ring, writers may have more space.
+    wake_up_all(&device->writeq);
+    mutex_unlock(&device->configLock);
+    return retVal;
+}
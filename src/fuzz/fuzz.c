@@ -0,0 +1,172 @@
+/* Userspace differential fuzzer for caesar.c, built and run by make fuzz (no root, no module).
+ * Every implementation this CPU can run (SWAR, SSE2, AVX2) has to turn random strings into exactly the bytes the lookup table
+ * (CAESAR_SCALAR) gives, for every offset, length and alignment, without touching a byte outside of the string.
+ * First every shift is checked against all 256 byte values at every alignment, then random cases run until the time is up.
+ * A mismatch prints the case and ends the run with a non-zero exit code.
+ *
+ * usage: translate_fuzz [--seconds n] [--seed n]
+ */
+#include <time.h>
+#include "../Caesar.h"
+
+#define DEFAULT_SECONDS 10
+#define MAX_LENGTH  ((size_t)64U * 1024U) /* longer than TRANSFORM_CHUNK_SIZE, the device never passes more at once */
+#define MAX_MISALIGNMENT    64U /* the string starts this many bytes after an aligned address at most */
+#define GUARD_SIZE  64U /* bytes before and after the string that no implementation may change */
+#define GUARD_BYTE  'q' /* in the alphabet, an implementation that runs over the end would change it */
+#define BUFFER_SIZE (GUARD_SIZE + MAX_MISALIGNMENT + MAX_LENGTH + GUARD_SIZE)
+
+typedef struct { // one comparison, printed when it fails
+    int offset;
+    size_t length;
+    size_t misalignment;
+    BOOL encode;
+} FuzzCase;
+
+static u64 randomState;
+static char const edgeBytes[] = { '@', 'A', 'B', 'Y', 'Z', '[', '`', 'a', 'b', 'y', 'z', '{', ' ', '!', '\x1f', '\0', '\x7f', '\x80', '\xc1', '\xda', '\xe1', '\xff' }; // the range boundaries and their high bit twins
+
+static u64 nextRandom(void) { // xorshift64*
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return randomState * 0x2545F4914F6CDD1DULL;
+}
+
+static size_t randomLength(void) { // mostly around the thresholds of the kernels, sometimes up to MAX_LENGTH
+    switch (nextRandom() % 4U) {
+    case 0:
+        return (size_t)(nextRandom() % 64U);
+    case 1:
+        return CAESAR_SIMD_MIN_LENGTH - 40U + (size_t)(nextRandom() % 80U);
+    case 2:
+        return (size_t)(nextRandom() % 4096U);
+    default:
+        return (size_t)(nextRandom() % (MAX_LENGTH + 1U));
+    } // end switch
+}
+
+static void fillRandom(char *string, size_t length) { // a mix of uniform bytes, alphabet characters and edge bytes, which one changes per case
+    u64 const style = nextRandom() % 3U;
+    for (size_t i = 0U; i < length; ++i) {
+        u64 const value = nextRandom();
+        if (style == 0U || (value & 0x300U) == 0U) {
+            string[i] = (char)value;
+        } else if (style == 1U || (value & 0x300U) == 0x100U) {
+            string[i] = CAESAR_ALPHABET[(value >> 16) % CAESAR_ALPHABET_LEN];
+        } else {
+            string[i] = edgeBytes[(value >> 16) % sizeof(edgeBytes)];
+        } // end if
+    } // end for
+}
+
+static BOOL check(CaesarImplementation implementation, CaesarTable const *table, char const *input, char *expected, char *actual, FuzzCase const *fuzzCase) {
+    /* Runs the scalar table and implementation over the same input inside guard bytes and reports the first difference. */
+    size_t const total = GUARD_SIZE + fuzzCase->misalignment + fuzzCase->length + GUARD_SIZE;
+    memset(expected, GUARD_BYTE, total);
+    memcpy(expected + GUARD_SIZE + fuzzCase->misalignment, input, fuzzCase->length);
+    memcpy(actual, expected, total);
+    char *expectedString = expected + GUARD_SIZE + fuzzCase->misalignment;
+    char *actualString = actual + GUARD_SIZE + fuzzCase->misalignment;
+    if (fuzzCase->encode) {
+        encodeStringWith(CAESAR_SCALAR, table, expectedString, fuzzCase->length);
+        encodeStringWith(implementation, table, actualString, fuzzCase->length);
+    } else {
+        decodeStringWith(CAESAR_SCALAR, table, expectedString, fuzzCase->length);
+        decodeStringWith(implementation, table, actualString, fuzzCase->length);
+    } // end if
+    for (size_t i = 0U; i < total; ++i) {
+        if (expected[i] != actual[i]) {
+            long position = (long)i - (long)(GUARD_SIZE + fuzzCase->misalignment); // negative or >= length: outside of the string
+            fprintf(stderr, "%s %s mismatch: offset %d length %zu misalignment %zu, byte %ld of the string is 0x%02x, expected 0x%02x (input 0x%02x)\n",
+                    caesarImplementationNames[implementation], fuzzCase->encode ? "encode" : "decode", fuzzCase->offset, fuzzCase->length,
+                    fuzzCase->misalignment, position, (unsigned char)actual[i], (unsigned char)expected[i],
+                    (position >= 0 && (size_t)position < fuzzCase->length) ? (unsigned char)input[position] : (unsigned char)GUARD_BYTE);
+            return FALSE;
+        } // end if
+    } // end for
+    return TRUE;
+}
+
+static BOOL checkAll(CaesarTable const *table, char const *input, char *expected, char *actual, FuzzCase *fuzzCase, u64 *cases) { // every available implementation, both directions
+    for (int implementation = CAESAR_SWAR; implementation < CAESAR_IMPLEMENTATIONS; ++implementation) {
+        if (!caesarImplementationAvailable((CaesarImplementation)implementation)) {
+            continue;
+        } // end if
+        for (int encode = 0; encode < 2; ++encode) {
+            fuzzCase->encode = (BOOL)encode;
+            if (!check((CaesarImplementation)implementation, table, input, expected, actual, fuzzCase)) {
+                return FALSE;
+            } // end if
+            ++*cases;
+        } // end for
+    } // end for
+    return TRUE;
+}
+
+int main(int argc, char **argv) {
+    long seconds = DEFAULT_SECONDS;
+    randomState = (u64)time(NULL);
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = strtol(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            randomState = strtoull(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [--seconds n] [--seed n]\n", argv[0]);
+            return EXIT_FAILURE;
+        } // end if
+    } // end for
+    if (randomState == 0U) { // xorshift would never leave 0
+        randomState = 1U;
+    } // end if
+    printf("seed %llu\n", (unsigned long long)randomState);
+    for (int implementation = 0; implementation < CAESAR_IMPLEMENTATIONS; ++implementation) {
+        printf("%s %s\n", caesarImplementationNames[implementation], caesarImplementationAvailable((CaesarImplementation)implementation) ? "available" : "not available");
+    } // end for
+
+    char *input = malloc(MAX_LENGTH);
+    char *expected = malloc(BUFFER_SIZE);
+    char *actual = malloc(BUFFER_SIZE);
+    if (input == NULL || expected == NULL || actual == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    } // end if
+
+    u64 cases = 0U;
+    CaesarTable table;
+    FuzzCase fuzzCase;
+    fuzzCase.length = 4U * CAESAR_SIMD_MIN_LENGTH; // every byte value in every lane of the widest kernel, plus a tail
+    for (size_t i = 0U; i < fuzzCase.length; ++i) {
+        input[i] = (char)(i * 7U); // 7 is odd, every 256 bytes are a permutation of all byte values
+    } // end for
+    for (int offset = 0; offset < CAESAR_ALPHABET_LEN; ++offset) {
+        initCaesarTable(&table, CAESAR_ALPHABET, offset);
+        fuzzCase.offset = offset;
+        for (fuzzCase.misalignment = 0U; fuzzCase.misalignment < MAX_MISALIGNMENT; ++fuzzCase.misalignment) {
+            if (!checkAll(&table, input, expected, actual, &fuzzCase, &cases)) {
+                return EXIT_FAILURE;
+            } // end if
+        } // end for
+    } // end for
+
+    time_t const end = time(NULL) + seconds;
+    while (time(NULL) < end) {
+        for (int batch = 0; batch < 256; ++batch) { // time() is not free
+            fuzzCase.offset = (int)(nextRandom() % 1001U) - 500; // negative and larger than the alphabet too
+            fuzzCase.length = randomLength();
+            fuzzCase.misalignment = (size_t)(nextRandom() % MAX_MISALIGNMENT);
+            initCaesarTable(&table, CAESAR_ALPHABET, fuzzCase.offset);
+            fillRandom(input, fuzzCase.length);
+            if (!checkAll(&table, input, expected, actual, &fuzzCase, &cases)) {
+                return EXIT_FAILURE;
+            } // end if
+        } // end for
+    } // end while
+
+    printf("ok, %llu cases\n", (unsigned long long)cases);
+    free(input);
+    free(expected);
+    free(actual);
+    return EXIT_SUCCESS;
+}
@@ -1,30 +1,33 @@
 #!/bin/sh
 module="translate"
 device="trans"
-mode="777"
+mode="666"
 
-# remove stale nodes
-rm -f /dev/${device}[0-1]
-
-# delete module
+# delete module, its device nodes go with it
 /sbin/rmmod $module
 
+# remove stale nodes, e.g. from versions that created them with mknod
+rm -f /dev/${device}[0-9]*
+
 # invoke insmod with all arguments we got
 # and use a pathname, as newer modutils don't look in . by default
-# call with arguments to set bufSize and transOffset
+# call with arguments to set bufSize, transOffset and the number of device pairs
 # example:
 # sudo ./install.sh bufSize=10 transOffset=5
+# sudo ./install.sh numPairs=4 pairOffsets=3,5,7,9 pairBufSizes=4096,4096,65536,65536
+# sudo ./install.sh sharedMode=1 atomicWriteSize=512 bufSize=65536
+# sudo ./install.sh sessionMode=1 bufSize=65536
+# sudo ./install.sh caesarImplementation=swar
+# sudo ./install.sh legacyWakeups=1
 /sbin/insmod ./$module.ko $* || exit 1
 
-major=$(grep /proc/devices -e $module | cut -d\  -f1)
-
-mknod /dev/${device}0 c $major 0
-mknod /dev/${device}1 c $major 1
+# the module creates /dev/trans0 ... /dev/trans(2 * numPairs - 1) itself, wait until udev made them
+command -v udevadm >/dev/null 2>&1 && udevadm settle
 
 # give appropriate group/permissions, and change the group.
 # not all distributions have staff, some have "wheel" instead.
 group="staff"
 grep -q '^staff:' /etc/group || group="wheel"
 
-chgrp $group /dev/${device}[0-1]
-chmod $mode /dev/${device}[0-1]
+chgrp $group /dev/${device}[0-9]*
+chmod $mode /dev/${device}[0-9]*
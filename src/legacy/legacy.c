@@ -0,0 +1,126 @@
+/* Userspace equivalence check of caesar.c against the original per-character implementation, built and run by make legacy (no root, no module).
+ * caesarChar below is the strchr-and-step code the module used before the lookup tables, kept as it was apart from taking the alphabet
+ * as a parameter. Every byte value is translated with it and with every caesar implementation this CPU can run, for the offsets 0 to 53,
+ * their negatives and some large ones, in both directions. The first difference is printed and ends the run with a non-zero exit code.
+ *
+ * The original took the offset as a size_t and stepped that many times, a negative offset would have stepped (nearly) forever.
+ * The lookup tables define a negative offset as that many steps backwards, which is what the original's decodeString did,
+ * so for offset < 0 encoding is compared with the original decoding by -offset and the other way round.
+ *
+ * usage: translate_legacy
+ */
+#include "../Caesar.h"
+
+#define TEXT_LENGTH (4U * CAESAR_SIMD_MIN_LENGTH) /* long enough for every kernel, every byte value appears in every lane */
+
+static void incrementCharPointer(char const **ptr, char const *begin, char const *end);
+static void decrementCharPointer(char const **ptr, char const *begin, char const *end);
+
+static char caesarChar(char const *alphabet, char caesarThis, size_t changeBy, BOOL encode) { // the original, see the comment at the top
+    char const *end // pointer to the end of the string
+        = alphabet + strlen(alphabet) - 1U; // the last character, the original computed it from alphBufSiz
+    
+    char const *pointer = strchr(alphabet, caesarThis);
+    if (pointer == NULL) {
+        return caesarThis;
+    }
+    for (size_t i = 0U; i < changeBy; ++i) {
+        if (encode) {
+            incrementCharPointer(&pointer, alphabet, end);
+        } else {
+            decrementCharPointer(&pointer, alphabet, end);
+        }
+    }
+    return *pointer;
+}
+
+static void incrementCharPointer(char const **ptr, char const *begin, char const *end) {
+    if (*ptr == end) {
+        *ptr = begin;
+    } else {
+        ++*ptr;
+    }
+}
+
+static void decrementCharPointer(char const **ptr, char const *begin, char const *end) {
+    if (*ptr == begin) {
+        *ptr = end;
+    } else {
+        --*ptr;
+    }
+}
+
+static char legacyTranslate(char character, int offset, BOOL encode) { // the original for any int offset, '\0' ended its strings and was never translated
+    if (character == '\0') {
+        return character;
+    } // end if
+    if (offset < 0) {
+        return caesarChar(CAESAR_ALPHABET, character, (size_t)-(long)offset, !encode);
+    } // end if
+    return caesarChar(CAESAR_ALPHABET, character, (size_t)offset, encode);
+}
+
+static BOOL check(CaesarImplementation implementation, int offset, BOOL encode, char const *expected, char *text) { // expected: the original's result for every byte value
+    for (size_t i = 0U; i < TEXT_LENGTH; ++i) {
+        text[i] = (char)i; // all 256 byte values, over and over
+    } // end for
+    CaesarTable table;
+    initCaesarTable(&table, CAESAR_ALPHABET, offset);
+    if (encode) {
+        encodeStringWith(implementation, &table, text, TEXT_LENGTH);
+    } else {
+        decodeStringWith(implementation, &table, text, TEXT_LENGTH);
+    } // end if
+    for (size_t i = 0U; i < TEXT_LENGTH; ++i) {
+        if (text[i] != expected[i % CAESAR_TABLE_SIZE]) {
+            fprintf(stderr, "%s %s with offset %d: byte 0x%02x became 0x%02x, the original gives 0x%02x\n", caesarImplementationNames[implementation],
+                    encode ? "encode" : "decode", offset, (unsigned char)i, (unsigned char)text[i], (unsigned char)expected[i % CAESAR_TABLE_SIZE]);
+            return FALSE;
+        } // end if
+    } // end for
+    return TRUE;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return EXIT_FAILURE;
+    } // end if
+    static int const largeOffsets[] = { 54, 106, 1000, 2809, 12345, 99991, 1000003, -54, -1000, -1000003 }; // 2809 is 53 * 53
+    int offsets[2 * (CAESAR_ALPHABET_LEN + 1) + COUNTOF(largeOffsets)];
+    size_t offsetCount = 0U;
+    for (int offset = 0; offset <= CAESAR_ALPHABET_LEN; ++offset) {
+        offsets[offsetCount++] = offset;
+        offsets[offsetCount++] = -offset;
+    } // end for
+    for (size_t i = 0U; i < COUNTOF(largeOffsets); ++i) {
+        offsets[offsetCount++] = largeOffsets[i];
+    } // end for
+
+    for (int implementation = 0; implementation < CAESAR_IMPLEMENTATIONS; ++implementation) {
+        if (!caesarImplementationAvailable((CaesarImplementation)implementation)) {
+            printf("%s not available\n", caesarImplementationNames[implementation]);
+        } // end if
+    } // end for
+    char text[TEXT_LENGTH];
+    char expected[CAESAR_TABLE_SIZE];
+    size_t checks = 0U;
+    for (size_t i = 0U; i < offsetCount; ++i) {
+        for (int encode = 0; encode < 2; ++encode) {
+            for (size_t value = 0U; value < CAESAR_TABLE_SIZE; ++value) { // the original steps offset times per character, only once per offset and direction
+                expected[value] = legacyTranslate((char)value, offsets[i], (BOOL)encode);
+            } // end for
+            for (int implementation = 0; implementation < CAESAR_IMPLEMENTATIONS; ++implementation) {
+                if (!caesarImplementationAvailable((CaesarImplementation)implementation)) {
+                    continue;
+                } // end if
+                if (!check((CaesarImplementation)implementation, offsets[i], (BOOL)encode, expected, text)) {
+                    return EXIT_FAILURE;
+                } // end if
+                ++checks;
+            } // end for
+        } // end for
+    } // end for
+    printf("ok, %zu offset/direction/implementation combinations match the original caesarChar\n", checks);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,1162 @@
+/* End-to-end load generator for the trans devices.
+ *
+ * For every device pair a producer thread writes numbered messages of plaintext to the encoder (trans0),
+ * a relay thread moves the ciphertext from the encoder to the decoder (trans1) and a consumer thread reads
+ * the decoded text back, checks that it matches what was written and records the round trip latency of every message.
+ * Message sizes, and optionally the bufSize/transOffset module parameters (by reloading the module through install.sh),
+ * are swept; every combination prints one JSON object with MB/s, syscalls/s, context switches per MB
+ * and p50/p99/p999 round trip latency.
+ * With --transform there is no queue at all: one thread per pair encodes and decodes its messages with TRANS_IOC_TRANSFORM.
+ * With --threads the module has to be loaded with sharedMode=1: n producers, n relays and n consumers, each with its own descriptor,
+ * share trans0 and trans1 and every message is one record (see atomicWriteSize). The thread counts are swept like the message sizes.
+ *
+ * With --epoll every pair is one thread that is producer, relay and consumer at once on O_NONBLOCK descriptors of trans0 and trans1 behind one epoll instance.
+ * It counts the EAGAINs and fails the run if a read or write gets EAGAIN right after epoll reported it ready, or poll still reports ready right after EAGAIN.
+ *
+ * usage: translate_loadgen [--sizes 16,4096,...] [--bytes total] [--pairs n] [--read-size n] [--batch n] [--splice] [--mmap] [--transform] [--epoll] [--timeout seconds]
+ *                          [--threads 1,2,4,...|scale] [--install ./install.sh [--compare-wakeups] --buf-sizes 40,4096,... --offsets 3,7,...]
+ * --compare-wakeups runs every combination twice, with the module reloaded with legacyWakeups=1 (every read and write wakes every sleeper,
+ * like the single wait queue before readq and writeq) and with the default. "wakeups" in the output tells them apart, compare context_switches_per_mb.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+
+#include "../TransIoctl.h"
+
+#define MAX_LIST    32 /* values per sweep option */
+#define MAX_PAIRS   64
+#define MAX_BATCH   IOV_MAX /* messages per writev */
+#ifndef DEVICE_PATH_FORMAT
+#define DEVICE_PATH_FORMAT  "/dev/trans%d"
+#endif
+#define DEFAULT_TOTAL_BYTES (64UL * 1024UL * 1024UL) /* per run and pair */
+#define DEFAULT_READ_SIZE   65536UL
+#define DEFAULT_TIMEOUT 120 /* seconds per run, a stuck device must not hang a sweep forever */
+#define EXIT_TIMEOUT    2
+#define TRANSFORM_OFFSET    3 /* any offset does, the round trip has to give back the plaintext */
+#define MAX_THREADS 256 /* per role with --threads */
+#define MESSAGE_ID_DIGITS   16 /* with --threads every message starts with its number in decimal, digits are not in the caesar alphabet */
+#define PARAMETER_PATH_FORMAT   "/sys/module/translate/parameters/%s"
+#define CAPACITY_PATH_FORMAT    "/sys/class/translate/trans%d/capacity"
+#define ATOMIC_WRITE_SIZE   4096L /* the module's default atomicWriteSize, if its parameters can not be read */
+
+typedef struct { // one sweep option, e.g. --sizes 16,4096
+    long values[MAX_LIST];
+    int count;
+} ValueList;
+
+typedef struct { // how every run of a sweep moves its data, from the command line
+    int pairs;
+    uint64_t totalBytes; // per run and pair
+    size_t readSize;
+    size_t batch; // messages handed to one writev, 1 uses write
+    int splice; // the relay moves trans0 -> pipe -> trans1 with splice instead of read and write
+    int mapped; // the producer writes into the mmap'ed ring of trans0 instead of calling write
+    int transform; // round trips through TRANS_IOC_TRANSFORM instead of the queues
+    unsigned timeout;
+    int shared; // --threads was given, every run shares trans0 and trans1 between all threads
+    int epoll; // one thread per pair drives trans0 and trans1 through O_NONBLOCK descriptors and epoll
+    int compareWakeups; // every combination runs twice, after reloading the module with legacyWakeups=1 and with legacyWakeups=0
+} LoadOptions;
+
+typedef struct { // the state of one encoder/decoder pair during a run
+    LoadOptions const *options;
+    int pairIndex;
+    int encoderFd;
+    int decoderFd;
+    size_t messageSize;
+    size_t messageCount;
+    uint64_t *sendTimes; // ns, written by the producer before a message is sent, read by the consumer after it came back
+    uint64_t *latencies; // ns, one per message
+    uint64_t syscalls; // read and write calls of all three threads
+    uint64_t mismatches; // bytes that did not survive the round trip
+    int error; // errno of the first failed syscall, 0 if none
+    int threads; // --threads: producers, relays and consumers that share trans0 and trans1
+    size_t recordSize; // --threads: the bytes a relay reads and writes at once, whole messages that the module keeps together
+    int nextThread; // --threads: hands every producer its number
+    uint64_t relayed; // --threads: bytes read from trans0 by all relays
+    uint64_t received; // --threads: bytes read from trans1 by all consumers
+    sem_t done; // --threads: posted once everything came back or a thread failed
+    uint64_t wouldBlock; // --epoll: reads and writes that got EAGAIN
+    uint64_t readinessErrors; // --epoll: EAGAIN right after epoll reported ready, or poll reporting ready right after EAGAIN
+} PairRun;
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static char patternByte(uint64_t streamOffset) { // the plaintext, a mix of characters inside and outside of the caesar alphabet
+    static char const text[] = "Pack my box with five dozen liquor jugs. 0123456789\n";
+    return text[(streamOffset * 7U + streamOffset / 61U) % (sizeof(text) - 1U)];
+}
+
+static void atomicAdd(uint64_t *counter, uint64_t value) {
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static void recordError(PairRun *run, int error) {
+    int expected = 0;
+    __atomic_compare_exchange_n(&run->error, &expected, error, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+static int writeAll(PairRun *run, int fd, char const *buffer, size_t count) {
+    size_t done = 0U;
+    while (done < count) {
+        ssize_t written = write(fd, buffer + done, count - done);
+        atomicAdd(&run->syscalls, 1U);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            } // end if
+            recordError(run, errno);
+            return -1;
+        } // end if
+        done += (size_t)written;
+    } // end while
+    return 0;
+}
+
+static int writevAll(PairRun *run, int fd, struct iovec *iov, int iovCount) { // advances iov past whatever a short writev took
+    while (iovCount > 0) {
+        ssize_t written = writev(fd, iov, iovCount);
+        atomicAdd(&run->syscalls, 1U);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            } // end if
+            recordError(run, errno);
+            return -1;
+        } // end if
+        while (iovCount > 0 && (size_t)written >= iov->iov_len) {
+            written -= (ssize_t)iov->iov_len;
+            ++iov;
+            --iovCount;
+        } // end while
+        if (iovCount > 0) {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= (size_t)written;
+        } // end if
+    } // end while
+    return 0;
+}
+
+static void *producerThread(void *argument) { // sends batch messages per syscall, every message is its own iovec segment
+    PairRun *run = argument;
+    char *messages = malloc(run->messageSize * run->options->batch);
+    struct iovec iov[MAX_BATCH];
+    if (messages == NULL) {
+        recordError(run, ENOMEM);
+        return NULL;
+    } // end if
+    uint64_t streamOffset = 0U;
+    for (size_t i = 0U; i < run->messageCount && run->error == 0; i += run->options->batch) {
+        size_t inBatch = (run->messageCount - i < run->options->batch) ? run->messageCount - i : run->options->batch;
+        for (size_t j = 0U; j < run->messageSize * inBatch; ++j) {
+            messages[j] = patternByte(streamOffset + j);
+        } // end for
+        for (size_t k = 0U; k < inBatch; ++k) {
+            iov[k].iov_base = messages + k * run->messageSize;
+            iov[k].iov_len = run->messageSize;
+            __atomic_store_n(&run->sendTimes[i + k], nowNs(), __ATOMIC_RELEASE);
+        } // end for
+        int result = (run->options->batch == 1U) ? writeAll(run, run->encoderFd, messages, run->messageSize)
+                                         : writevAll(run, run->encoderFd, iov, (int)inBatch);
+        if (result != 0) {
+            break;
+        } // end if
+        streamOffset += run->messageSize * inBatch;
+    } // end for
+    free(messages);
+    return NULL;
+}
+
+static void *spliceRelayThread(void *argument) { // trans0 -> pipe -> trans1, the bytes never reach user space
+    PairRun *run = argument;
+    int pipeFds[2];
+    if (pipe(pipeFds) != 0) {
+        recordError(run, errno);
+        return NULL;
+    } // end if
+    fcntl(pipeFds[1], F_SETPIPE_SZ, (int)run->options->readSize); // best effort, the default pipe holds 64 KiB
+    uint64_t remaining = (uint64_t)run->messageSize * run->messageCount;
+    while (remaining > 0U && run->error == 0) {
+        ssize_t got = splice(run->encoderFd, NULL, pipeFds[1], NULL, remaining < run->options->readSize ? (size_t)remaining : run->options->readSize, SPLICE_F_MOVE);
+        atomicAdd(&run->syscalls, 1U);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            } // end if
+            recordError(run, errno);
+            break;
+        } // end if
+        ssize_t inPipe = got;
+        while (inPipe > 0) {
+            ssize_t moved = splice(pipeFds[0], NULL, run->decoderFd, NULL, (size_t)inPipe, SPLICE_F_MOVE);
+            atomicAdd(&run->syscalls, 1U);
+            if (moved < 0) {
+                if (errno == EINTR) {
+                    continue;
+                } // end if
+                recordError(run, errno);
+                break;
+            } // end if
+            inPipe -= moved;
+        } // end while
+        remaining -= (uint64_t)got;
+    } // end while
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+    return NULL;
+}
+
+static void *mappedProducerThread(void *argument) { // writes the plaintext straight into the ring of trans0, see TransIoctl.h
+    PairRun *run = argument;
+    long mapSize = ioctl(run->encoderFd, TRANS_IOC_MAP_SIZE);
+    void *map = (mapSize > 0) ? mmap(NULL, (size_t)mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, run->encoderFd, 0) : MAP_FAILED;
+    atomicAdd(&run->syscalls, 2U);
+    if (map == MAP_FAILED) {
+        recordError(run, errno);
+        return NULL;
+    } // end if
+    TransRingControl *control = map;
+    char *data = (char *)map + control->dataOffset;
+    ring_index_type mask = control->dataSize - 1U;
+    ring_index_type produced = __atomic_load_n(&control->produced, __ATOMIC_ACQUIRE);
+    uint64_t total = (uint64_t)run->messageSize * run->messageCount;
+    uint64_t streamOffset = 0U;
+    size_t nextMessage = 0U; // the first message that was not stamped yet
+    while (streamOffset < total && run->error == 0) {
+        ring_index_type tail = __atomic_load_n(&control->tail, __ATOMIC_ACQUIRE);
+        size_t freeBytes = control->capacity - (ring_index_type)(produced - tail);
+        if (freeBytes == 0U) { // sleep until the consumer made room, poll also transforms what we published so far.
+            struct pollfd pollFd = { run->encoderFd, POLLOUT, 0 };
+            poll(&pollFd, 1, -1);
+            atomicAdd(&run->syscalls, 1U);
+            continue;
+        } // end if
+        size_t count = (total - streamOffset < freeBytes) ? (size_t)(total - streamOffset) : freeBytes;
+        for (; nextMessage < run->messageCount && (uint64_t)nextMessage * run->messageSize < streamOffset + count; ++nextMessage) {
+            __atomic_store_n(&run->sendTimes[nextMessage], nowNs(), __ATOMIC_RELEASE);
+        } // end for
+        for (size_t i = 0U; i < count; ++i) {
+            data[(ring_index_type)(produced + i) & mask] = patternByte(streamOffset + i);
+        } // end for
+        produced += (ring_index_type)count;
+        __atomic_store_n(&control->produced, produced, __ATOMIC_RELEASE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST); // the store to produced before the check of readerWaiting, see TransIoctl.h
+        if (__atomic_load_n(&control->readerWaiting, __ATOMIC_RELAXED) != 0U) {
+            ioctl(run->encoderFd, TRANS_IOC_DOORBELL);
+            atomicAdd(&run->syscalls, 1U);
+        } // end if
+        streamOffset += count;
+    } // end while
+    munmap(map, (size_t)mapSize);
+    return NULL;
+}
+
+static void *transformThread(void *argument) { // encodes and decodes batch messages per TRANS_IOC_TRANSFORM, the queues are not involved
+    PairRun *run = argument;
+    size_t batch = run->options->batch;
+    char *messages = malloc(run->messageSize * batch);
+    TransTransformSegment *segments = malloc(2U * batch * sizeof(TransTransformSegment));
+    if (messages == NULL || segments == NULL) {
+        recordError(run, ENOMEM);
+        free(messages);
+        free(segments);
+        return NULL;
+    } // end if
+    uint64_t streamOffset = 0U;
+    for (size_t i = 0U; i < run->messageCount && run->error == 0; i += batch) {
+        size_t inBatch = (run->messageCount - i < batch) ? run->messageCount - i : batch;
+        for (size_t j = 0U; j < run->messageSize * inBatch; ++j) {
+            messages[j] = patternByte(streamOffset + j);
+        } // end for
+        for (size_t k = 0U; k < inBatch; ++k) { // every message is encoded and then decoded again, the segments are done in order.
+            TransTransformSegment segment = { (uint64_t)(uintptr_t)(messages + k * run->messageSize), run->messageSize, TRANS_ENCODE, TRANSFORM_OFFSET };
+            segments[k] = segment;
+            segment.direction = TRANS_DECODE;
+            segments[inBatch + k] = segment;
+        } // end for
+        TransTransformRequest request = { (uint64_t)(uintptr_t)segments, (uint32_t)(2U * inBatch), 0U };
+        uint64_t start = nowNs();
+        long result = ioctl(run->encoderFd, TRANS_IOC_TRANSFORM, &request);
+        uint64_t end = nowNs();
+        atomicAdd(&run->syscalls, 1U);
+        if (result < 0) {
+            recordError(run, errno);
+            break;
+        } // end if
+        for (size_t j = 0U; j < run->messageSize * inBatch; ++j) {
+            if (messages[j] != patternByte(streamOffset + j)) {
+                ++run->mismatches;
+            } // end if
+        } // end for
+        for (size_t k = 0U; k < inBatch; ++k) {
+            run->latencies[i + k] = end - start;
+        } // end for
+        streamOffset += run->messageSize * inBatch;
+    } // end for
+    free(messages);
+    free(segments);
+    return NULL;
+}
+
+static void *relayThread(void *argument) { // trans0 -> trans1
+    PairRun *run = argument;
+    char *buffer = malloc(run->options->readSize);
+    if (buffer == NULL) {
+        recordError(run, ENOMEM);
+        return NULL;
+    } // end if
+    uint64_t remaining = (uint64_t)run->messageSize * run->messageCount;
+    while (remaining > 0U && run->error == 0) {
+        ssize_t got = read(run->encoderFd, buffer, remaining < run->options->readSize ? (size_t)remaining : run->options->readSize);
+        atomicAdd(&run->syscalls, 1U);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            } // end if
+            recordError(run, errno);
+            break;
+        } // end if
+        if (writeAll(run, run->decoderFd, buffer, (size_t)got) != 0) {
+            break;
+        } // end if
+        remaining -= (uint64_t)got;
+    } // end while
+    free(buffer);
+    return NULL;
+}
+
+static void *consumerThread(void *argument) { // reads trans1 and checks the round trip
+    PairRun *run = argument;
+    char *buffer = malloc(run->options->readSize);
+    if (buffer == NULL) {
+        recordError(run, ENOMEM);
+        return NULL;
+    } // end if
+    uint64_t total = (uint64_t)run->messageSize * run->messageCount;
+    uint64_t received = 0U;
+    while (received < total && run->error == 0) {
+        ssize_t got = read(run->decoderFd, buffer, (total - received) < run->options->readSize ? (size_t)(total - received) : run->options->readSize);
+        atomicAdd(&run->syscalls, 1U);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            } // end if
+            recordError(run, errno);
+            break;
+        } // end if
+        uint64_t now = nowNs();
+        for (ssize_t i = 0; i < got; ++i) {
+            if (buffer[i] != patternByte(received + (uint64_t)i)) {
+                ++run->mismatches;
+            } // end if
+        } // end for
+        uint64_t firstMessage = received / run->messageSize;
+        received += (uint64_t)got;
+        uint64_t completeMessages = received / run->messageSize; // every message that ended inside this read is done now
+        for (uint64_t message = firstMessage; message < completeMessages; ++message) {
+            run->latencies[message] = now - __atomic_load_n(&run->sendTimes[message], __ATOMIC_ACQUIRE);
+        } // end for
+    } // end while
+    free(buffer);
+    return NULL;
+}
+
+
+static int stillReady(int fd, short event) { // --epoll: asks poll once more without waiting
+    struct pollfd pollFd = { fd, event, 0 };
+    return poll(&pollFd, 1U, 0) == 1 && (pollFd.revents & event) != 0;
+}
+
+static ssize_t tryTransfer(PairRun *run, int fd, char *buffer, size_t count, int writing, int *fresh) { /* --epoll: one nonblocking read or write.
+    * The first call after epoll reported the direction ready must not get EAGAIN, and after EAGAIN poll must not report it ready any more:
+    * either way a nonblocking caller would spin. Both count as readiness errors. Returns -1 with errno EAGAIN when the direction is done for now.
+    */
+    short const event = writing ? POLLOUT : POLLIN;
+    ssize_t result;
+    do {
+        result = writing ? write(fd, buffer, count) : read(fd, buffer, count);
+        atomicAdd(&run->syscalls, 1U);
+    } while (result < 0 && errno == EINTR);
+    int const wasFresh = *fresh;
+    *fresh = 0;
+    if (result >= 0) {
+        return result;
+    } // end if
+    if (errno != EAGAIN) {
+        recordError(run, errno);
+        return -1;
+    } // end if
+    ++run->wouldBlock;
+    if (wasFresh) { // epoll said ready, the device said EAGAIN
+        ++run->readinessErrors;
+    } // end if
+    if (stillReady(fd, event)) { // the device said EAGAIN, poll says ready
+        ++run->readinessErrors;
+    } // end if
+    errno = EAGAIN;
+    return -1;
+}
+
+static int updateInterest(PairRun *run, int epollFd, int fd, uint32_t *current, uint32_t wanted) { // --epoll: asks only for directions that have work
+    if (*current == wanted) {
+        return 0;
+    } // end if
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = wanted;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) != 0) {
+        recordError(run, errno);
+        return -1;
+    } // end if
+    *current = wanted;
+    return 0;
+}
+
+static void *epollThread(void *argument) { /* --epoll: one thread is producer, relay and consumer of a pair. Both descriptors are O_NONBLOCK and
+    * registered with one level triggered epoll instance, a direction is only read or written after epoll reported it ready and then until EAGAIN,
+    * so every EAGAIN is a ready -> not ready transition that poll has to agree with (see tryTransfer).
+    */
+    PairRun *run = argument;
+    size_t const readSize = run->options->readSize;
+    uint64_t const total = (uint64_t)run->messageSize * run->messageCount;
+    char *message = malloc(run->messageSize);
+    char *relayBuffer = malloc(readSize);
+    char *buffer = malloc(readSize);
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (message == NULL || relayBuffer == NULL || buffer == NULL || epollFd < 0) {
+        recordError(run, (epollFd < 0) ? errno : ENOMEM);
+        goto out;
+    } // end if
+    int const fds[2] = { run->encoderFd, run->decoderFd };
+    for (int i = 0; i < 2; ++i) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.data.fd = fds[i];
+        if (fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK) != 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, fds[i], &event) != 0) {
+            recordError(run, errno);
+            goto out;
+        } // end if
+    } // end for
+
+    uint64_t produced = 0U; // bytes written to trans0
+    uint64_t relayed = 0U; // bytes read from trans0
+    uint64_t received = 0U; // bytes read from trans1
+    size_t pending = 0U; // bytes in relayBuffer, read from trans0 and not yet all written to trans1
+    size_t forwarded = 0U; // of pending, already written to trans1
+    uint32_t encoderEvents = 0U;
+    uint32_t decoderEvents = 0U;
+    while (received < total && run->error == 0) {
+        uint32_t wantEncoder = ((produced < total) ? EPOLLOUT : 0U) | ((pending == 0U && relayed < total) ? EPOLLIN : 0U);
+        uint32_t wantDecoder = ((pending != 0U) ? EPOLLOUT : 0U) | EPOLLIN;
+        if (updateInterest(run, epollFd, run->encoderFd, &encoderEvents, wantEncoder) != 0
+            || updateInterest(run, epollFd, run->decoderFd, &decoderEvents, wantDecoder) != 0) {
+            break;
+        } // end if
+        struct epoll_event events[2];
+        int ready = epoll_wait(epollFd, events, 2, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            } // end if
+            recordError(run, errno);
+            break;
+        } // end if
+        for (int e = 0; e < ready && run->error == 0; ++e) {
+            uint32_t const flags = events[e].events;
+            int fresh;
+            if (flags & (EPOLLERR | EPOLLHUP)) {
+                recordError(run, EIO);
+                break;
+            } // end if
+            if (events[e].data.fd == run->encoderFd) {
+                if (flags & EPOLLOUT) { // producer, message by message until the ring is full
+                    fresh = 1;
+                    while (produced < total) {
+                        size_t inMessage = (size_t)(produced % run->messageSize);
+                        if (inMessage == 0U) {
+                            for (size_t j = 0U; j < run->messageSize; ++j) {
+                                message[j] = patternByte(produced + j);
+                            } // end for
+                            run->sendTimes[produced / run->messageSize] = nowNs();
+                        } // end if
+                        ssize_t written = tryTransfer(run, run->encoderFd, message + inMessage, run->messageSize - inMessage, 1, &fresh);
+                        if (written <= 0) {
+                            break;
+                        } // end if
+                        produced += (uint64_t)written;
+                    } // end while
+                } // end if
+                if ((flags & EPOLLIN) && pending == 0U) { // relay, trans0 -> relayBuffer
+                    fresh = 1;
+                    ssize_t got = tryTransfer(run, run->encoderFd, relayBuffer, (total - relayed < readSize) ? (size_t)(total - relayed) : readSize, 0, &fresh);
+                    if (got > 0) {
+                        pending = (size_t)got;
+                        forwarded = 0U;
+                        relayed += (uint64_t)got;
+                    } // end if
+                } // end if
+                continue;
+            } // end if
+            if ((flags & EPOLLOUT) && pending != 0U) { // relay, relayBuffer -> trans1
+                fresh = 1;
+                while (forwarded < pending) {
+                    ssize_t written = tryTransfer(run, run->decoderFd, relayBuffer + forwarded, pending - forwarded, 1, &fresh);
+                    if (written <= 0) {
+                        break;
+                    } // end if
+                    forwarded += (size_t)written;
+                } // end while
+                if (forwarded == pending) {
+                    pending = 0U;
+                } // end if
+            } // end if
+            if (flags & EPOLLIN) { // consumer, checks the round trip until trans1 is empty
+                fresh = 1;
+                while (received < total) {
+                    ssize_t got = tryTransfer(run, run->decoderFd, buffer, (total - received < readSize) ? (size_t)(total - received) : readSize, 0, &fresh);
+                    if (got <= 0) {
+                        break;
+                    } // end if
+                    uint64_t now = nowNs();
+                    for (ssize_t i = 0; i < got; ++i) {
+                        if (buffer[i] != patternByte(received + (uint64_t)i)) {
+                            ++run->mismatches;
+                        } // end if
+                    } // end for
+                    uint64_t firstMessage = received / run->messageSize;
+                    received += (uint64_t)got;
+                    for (uint64_t m = firstMessage; m < received / run->messageSize; ++m) {
+                        run->latencies[m] = now - run->sendTimes[m];
+                    } // end for
+                } // end while
+            } // end if
+        } // end for
+    } // end while
+out:
+    if (epollFd >= 0) {
+        close(epollFd);
+    } // end if
+    free(message);
+    free(relayBuffer);
+    free(buffer);
+    return NULL;
+}
+static void fillMessage(char *message, size_t messageSize, uint64_t id) { // --threads: the number, then the plaintext of the message's place in the stream
+    char digits[MESSAGE_ID_DIGITS + 1];
+    snprintf(digits, sizeof(digits), "%0*llu", MESSAGE_ID_DIGITS, (unsigned long long)id);
+    memcpy(message, digits, MESSAGE_ID_DIGITS);
+    for (size_t j = MESSAGE_ID_DIGITS; j < messageSize; ++j) {
+        message[j] = patternByte(id * messageSize + j);
+    } // end for
+}
+
+static void stopShared(PairRun *run, int error) { // --threads: a thread gave up, the others may wait for bytes that never come
+    recordError(run, error);
+    sem_post(&run->done);
+}
+
+static int openDevice(int minor, int flags) {
+    char path[64];
+    snprintf(path, sizeof(path), DEVICE_PATH_FORMAT, minor);
+    return open(path, flags);
+}
+
+static void closeFd(void *fd) { // a cleanup handler, the shared threads are cancelled at the end of a run
+    close(*(int *)fd);
+}
+
+static void *sharedProducerThread(void *argument) { // --threads: writes its messages to its own descriptor of trans0, one message per write
+    PairRun *run = argument;
+    int index = __atomic_fetch_add(&run->nextThread, 1, __ATOMIC_RELAXED);
+    int fd = openDevice(0, O_WRONLY);
+    char *message = malloc(run->messageSize);
+    if (fd < 0 || message == NULL) {
+        stopShared(run, fd < 0 ? errno : ENOMEM);
+        if (fd >= 0) {
+            close(fd);
+        } // end if
+        free(message);
+        return NULL;
+    } // end if
+    pthread_cleanup_push(&free, message);
+    pthread_cleanup_push(&closeFd, &fd);
+    for (size_t i = 0U; i < run->messageCount && run->error == 0; ++i) {
+        uint64_t id = (uint64_t)index * run->messageCount + i;
+        fillMessage(message, run->messageSize, id);
+        __atomic_store_n(&run->sendTimes[id], nowNs(), __ATOMIC_RELEASE);
+        if (writeAll(run, fd, message, run->messageSize) != 0) {
+            sem_post(&run->done);
+            break;
+        } // end if
+    } // end for
+    pthread_cleanup_pop(1);
+    pthread_cleanup_pop(1);
+    return NULL;
+}
+
+static void *sharedRelayThread(void *argument) { /* --threads: trans0 -> trans1 in whole messages. Blocks in read until the run is over,
+    * runShared cancels it then.
+    */
+    PairRun *run = argument;
+    uint64_t total = (uint64_t)run->threads * run->messageCount * run->messageSize;
+    int in = openDevice(0, O_RDONLY);
+    int out = openDevice(1, O_WRONLY);
+    char *buffer = malloc(run->recordSize);
+    if (in < 0 || out < 0 || buffer == NULL) {
+        stopShared(run, (in < 0 || out < 0) ? errno : ENOMEM);
+        if (in >= 0) {
+            close(in);
+        } // end if
+        if (out >= 0) {
+            close(out);
+        } // end if
+        free(buffer);
+        return NULL;
+    } // end if
+    pthread_cleanup_push(&free, buffer);
+    pthread_cleanup_push(&closeFd, &in);
+    pthread_cleanup_push(&closeFd, &out);
+    while (__atomic_load_n(&run->relayed, __ATOMIC_RELAXED) < total && run->error == 0) {
+        ssize_t got = read(in, buffer, run->recordSize);
+        atomicAdd(&run->syscalls, 1U);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            } // end if
+            stopShared(run, errno);
+            break;
+        } // end if
+        if ((size_t)got % run->messageSize != 0U) { // the device split a record
+            stopShared(run, EPROTO);
+            break;
+        } // end if
+        atomicAdd(&run->relayed, (uint64_t)got);
+        if (writeAll(run, out, buffer, (size_t)got) != 0) {
+            sem_post(&run->done);
+            break;
+        } // end if
+    } // end while
+    pthread_cleanup_pop(1);
+    pthread_cleanup_pop(1);
+    pthread_cleanup_pop(1);
+    return NULL;
+}
+
+static void *sharedConsumerThread(void *argument) { // --threads: reads trans1 and checks every message it gets, blocks in read until runShared cancels it
+    PairRun *run = argument;
+    uint64_t total = (uint64_t)run->threads * run->messageCount * run->messageSize;
+    uint64_t messages = (uint64_t)run->threads * run->messageCount;
+    int fd = openDevice(1, O_RDONLY);
+    char *buffer = malloc(run->recordSize);
+    char *expected = malloc(run->messageSize);
+    if (fd < 0 || buffer == NULL || expected == NULL) {
+        stopShared(run, fd < 0 ? errno : ENOMEM);
+        if (fd >= 0) {
+            close(fd);
+        } // end if
+        free(buffer);
+        free(expected);
+        return NULL;
+    } // end if
+    pthread_cleanup_push(&free, buffer);
+    pthread_cleanup_push(&free, expected);
+    pthread_cleanup_push(&closeFd, &fd);
+    while (run->error == 0) {
+        ssize_t got = read(fd, buffer, run->recordSize);
+        atomicAdd(&run->syscalls, 1U);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            } // end if
+            stopShared(run, errno);
+            break;
+        } // end if
+        uint64_t now = nowNs();
+        for (ssize_t offset = 0; offset + (ssize_t)run->messageSize <= got; offset += (ssize_t)run->messageSize) {
+            char *message = buffer + offset;
+            char digits[MESSAGE_ID_DIGITS + 1];
+            memcpy(digits, message, MESSAGE_ID_DIGITS);
+            digits[MESSAGE_ID_DIGITS] = '\0';
+            uint64_t id = strtoull(digits, NULL, 10);
+            if (id >= messages) { // the number itself did not survive
+                atomicAdd(&run->mismatches, run->messageSize);
+                continue;
+            } // end if
+            fillMessage(expected, run->messageSize, id);
+            for (size_t j = 0U; j < run->messageSize; ++j) {
+                if (message[j] != expected[j]) {
+                    atomicAdd(&run->mismatches, 1U);
+                } // end if
+            } // end for
+            run->latencies[id] = now - __atomic_load_n(&run->sendTimes[id], __ATOMIC_ACQUIRE);
+        } // end for
+        if ((size_t)got % run->messageSize != 0U) { // the device split a record
+            stopShared(run, EPROTO);
+            break;
+        } // end if
+        if (__atomic_add_fetch(&run->received, (uint64_t)got, __ATOMIC_RELAXED) == total) {
+            sem_post(&run->done);
+        } // end if
+    } // end while
+    pthread_cleanup_pop(1);
+    pthread_cleanup_pop(1);
+    pthread_cleanup_pop(1);
+    return NULL;
+}
+
+static void onTimeout(int signalNumber) {
+    static char const message[] = "\nrun timed out, the devices stopped moving data\n";
+    (void)signalNumber;
+    if (write(STDERR_FILENO, message, sizeof(message) - 1U) < 0) {
+        /* nothing left to report to */
+    } // end if
+    _exit(EXIT_TIMEOUT);
+}
+
+static int compareU64(void const *lhs, void const *rhs) {
+    uint64_t a = *(uint64_t const *)lhs;
+    uint64_t b = *(uint64_t const *)rhs;
+    return (a > b) - (a < b);
+}
+
+static uint64_t percentile(uint64_t const *sorted, size_t count, double fraction) {
+    if (count == 0U) {
+        return 0U;
+    } // end if
+    size_t index = (size_t)(fraction * (double)(count - 1U) + 0.5);
+    return sorted[index];
+}
+
+static long contextSwitches(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+static int parseList(char const *text, ValueList *list) {
+    list->count = 0;
+    char *copy = strdup(text);
+    if (copy == NULL) {
+        return -1;
+    } // end if
+    char *savePtr = NULL;
+    for (char *token = strtok_r(copy, ",", &savePtr); token != NULL; token = strtok_r(NULL, ",", &savePtr)) {
+        if (list->count == MAX_LIST) {
+            free(copy);
+            return -1;
+        } // end if
+        list->values[list->count++] = strtol(token, NULL, 0);
+    } // end for
+    free(copy);
+    return list->count > 0 ? 0 : -1;
+}
+
+static long readNumber(char const *path, long fallback) { // a module parameter or a sysfs attribute
+    FILE *file = fopen(path, "r");
+    long value = fallback;
+    if (file == NULL) {
+        return fallback;
+    } // end if
+    if (fscanf(file, "%ld", &value) != 1) {
+        value = fallback;
+    } // end if
+    fclose(file);
+    return value;
+}
+
+static long readParameter(char const *name, long fallback) {
+    char path[128];
+    snprintf(path, sizeof(path), PARAMETER_PATH_FORMAT, name);
+    return readNumber(path, fallback);
+}
+
+static char const *wakeupsName(void) { // how the loaded module wakes sleepers, labels every run
+    return readParameter("legacyWakeups", 0L) != 0L ? "legacy" : "split";
+}
+
+static long readCapacity(int minor) { // -1 if unknown
+    char path[128];
+    snprintf(path, sizeof(path), CAPACITY_PATH_FORMAT, minor);
+    return readNumber(path, -1L);
+}
+
+static int reloadModule(char const *installScript, int pairs, int shared, long bufSize, long transOffset,
+                        int legacyWakeups) { // -1 leaves a parameter at the module's default
+    char command[512];
+    int length = snprintf(command, sizeof(command), "%s numPairs=%d", installScript, pairs);
+    if (shared) {
+        length += snprintf(command + length, sizeof(command) - (size_t)length, " sharedMode=1");
+    } // end if
+    if (legacyWakeups >= 0) {
+        length += snprintf(command + length, sizeof(command) - (size_t)length, " legacyWakeups=%d", legacyWakeups);
+    } // end if
+    if (bufSize >= 0) {
+        length += snprintf(command + length, sizeof(command) - (size_t)length, " bufSize=%ld", bufSize);
+    } // end if
+    if (transOffset >= 0) {
+        length += snprintf(command + length, sizeof(command) - (size_t)length, " transOffset=%ld", transOffset);
+    } // end if
+    snprintf(command + length, sizeof(command) - (size_t)length, " >/dev/null 2>&1");
+    return system(command) == 0 ? 0 : -1;
+}
+
+static int runOnce(LoadOptions const *options, size_t messageSize,
+                   long bufSize, long transOffset) { // prints one JSON object, returns 0 if the round trip was intact
+    static int firstRun = 1;
+    int pairs = options->pairs;
+    PairRun runs[MAX_PAIRS];
+    pthread_t threads[MAX_PAIRS][3];
+    size_t messageCount = (size_t)(options->totalBytes / messageSize);
+    if (messageCount == 0U) {
+        messageCount = 1U;
+    } // end if
+
+    memset(runs, 0, sizeof(runs));
+    for (int p = 0; p < pairs; ++p) {
+        char path[64];
+        runs[p].options = options;
+        runs[p].pairIndex = p;
+        runs[p].messageSize = messageSize;
+        runs[p].messageCount = messageCount;
+        int accessMode = options->transform ? O_ACCMODE : O_RDWR; // O_ACCMODE: for ioctl only, see TransIoctl.h
+        snprintf(path, sizeof(path), DEVICE_PATH_FORMAT, 2 * p);
+        runs[p].encoderFd = open(path, accessMode);
+        snprintf(path, sizeof(path), DEVICE_PATH_FORMAT, 2 * p + 1);
+        runs[p].decoderFd = open(path, accessMode);
+        runs[p].sendTimes = calloc(messageCount, sizeof(uint64_t));
+        runs[p].latencies = calloc(messageCount, sizeof(uint64_t));
+        if (runs[p].encoderFd < 0 || runs[p].decoderFd < 0 || runs[p].sendTimes == NULL || runs[p].latencies == NULL) {
+            fprintf(stderr, "pair %d: cannot set up the run: %s\n", p, strerror(errno));
+            for (int q = 0; q <= p; ++q) {
+                close(runs[q].encoderFd);
+                close(runs[q].decoderFd);
+                free(runs[q].sendTimes);
+                free(runs[q].latencies);
+            } // end for
+            return -1;
+        } // end if
+    } // end for
+
+    alarm(options->timeout);
+    long switchesBefore = contextSwitches();
+    uint64_t start = nowNs();
+    int threadsPerPair = (options->transform || options->epoll) ? 1 : 3;
+    for (int p = 0; p < pairs; ++p) {
+        if (options->transform || options->epoll) {
+            pthread_create(&threads[p][0], NULL, options->epoll ? &epollThread : &transformThread, &runs[p]);
+            continue;
+        } // end if
+        pthread_create(&threads[p][0], NULL, &consumerThread, &runs[p]);
+        pthread_create(&threads[p][1], NULL, options->splice ? &spliceRelayThread : &relayThread, &runs[p]);
+        pthread_create(&threads[p][2], NULL, options->mapped ? &mappedProducerThread : &producerThread, &runs[p]);
+    } // end for
+    for (int p = 0; p < pairs; ++p) {
+        for (int t = 0; t < threadsPerPair; ++t) {
+            pthread_join(threads[p][t], NULL);
+        } // end for
+    } // end for
+    uint64_t elapsed = nowNs() - start;
+    long switches = contextSwitches() - switchesBefore;
+    alarm(0U);
+
+    uint64_t *allLatencies = malloc((size_t)pairs * messageCount * sizeof(uint64_t));
+    uint64_t syscalls = 0U;
+    uint64_t mismatches = 0U;
+    uint64_t wouldBlock = 0U;
+    uint64_t readinessErrors = 0U;
+    int error = 0;
+    for (int p = 0; p < pairs; ++p) {
+        if (allLatencies != NULL) {
+            memcpy(allLatencies + (size_t)p * messageCount, runs[p].latencies, messageCount * sizeof(uint64_t));
+        } // end if
+        syscalls += runs[p].syscalls;
+        mismatches += runs[p].mismatches;
+        wouldBlock += runs[p].wouldBlock;
+        readinessErrors += runs[p].readinessErrors;
+        if (error == 0) {
+            error = runs[p].error;
+        } // end if
+        close(runs[p].encoderFd);
+        close(runs[p].decoderFd);
+        free(runs[p].sendTimes);
+        free(runs[p].latencies);
+    } // end for
+    size_t latencyCount = (allLatencies != NULL) ? (size_t)pairs * messageCount : 0U;
+    if (allLatencies != NULL) {
+        qsort(allLatencies, latencyCount, sizeof(uint64_t), &compareU64);
+    } // end if
+
+    double seconds = (double)elapsed / 1e9;
+    double megabytes = (double)pairs * (double)messageCount * (double)messageSize / (1024.0 * 1024.0);
+    int intact = mismatches == 0U && error == 0 && readinessErrors == 0U; // with --epoll poll has to be right too
+    printf("%s  {\"pairs\": %d, \"message_size\": %zu, \"messages\": %zu, \"read_size\": %zu, \"batch\": %zu, \"producer\": \"%s\", \"relay\": \"%s\", "
+           "\"wakeups\": \"%s\", \"buf_size\": %ld, \"trans_offset\": %ld, \"seconds\": %.6f, "
+           "\"mb_per_s\": %.3f, \"syscalls_per_s\": %.1f, \"context_switches_per_mb\": %.3f, "
+           "\"latency_ns\": {\"p50\": %llu, \"p99\": %llu, \"p999\": %llu}, \"eagain\": %llu, \"readiness_errors\": %llu, "
+           "\"verified\": %s, \"mismatched_bytes\": %llu, \"error\": \"%s\"}",
+           firstRun ? "" : ",\n", pairs, messageSize, messageCount, options->readSize, options->batch,
+           options->epoll ? "epoll" : (options->transform ? "ioctl" : (options->mapped ? "mmap" : (options->batch > 1U ? "writev" : "write"))),
+           options->epoll ? "epoll" : (options->transform ? "none" : (options->splice ? "splice" : "read/write")),
+           wakeupsName(), bufSize, transOffset, seconds,
+           megabytes / seconds, (double)syscalls / seconds, megabytes > 0.0 ? (double)switches / megabytes : 0.0,
+           (unsigned long long)percentile(allLatencies, latencyCount, 0.50),
+           (unsigned long long)percentile(allLatencies, latencyCount, 0.99),
+           (unsigned long long)percentile(allLatencies, latencyCount, 0.999),
+           (unsigned long long)wouldBlock, (unsigned long long)readinessErrors,
+           intact ? "true" : "false", (unsigned long long)mismatches,
+           error != 0 ? strerror(error) : "");
+    fflush(stdout);
+    firstRun = 0;
+    free(allLatencies);
+    return intact ? 0 : -1;
+}
+
+static int runShared(LoadOptions const *options, size_t messageSize, int threads,
+                     long bufSize, long transOffset) { // --threads: prints one JSON object, returns 0 if every message came back intact
+    static int firstRun = 1;
+    if (messageSize < MESSAGE_ID_DIGITS) {
+        fprintf(stderr, "--threads needs messages of at least %d bytes, not %zu\n", MESSAGE_ID_DIGITS, messageSize);
+        return -1;
+    } // end if
+    long recordLimit = readParameter("atomicWriteSize", ATOMIC_WRITE_SIZE); // larger writes may be interleaved with the other producers
+    for (int minor = 0; minor < 2; ++minor) {
+        long capacity = readCapacity(minor);
+        if (capacity >= 0 && capacity < recordLimit) {
+            recordLimit = capacity;
+        } // end if
+    } // end for
+    if ((long)messageSize > recordLimit) {
+        fprintf(stderr, "--threads needs messages of at most %ld bytes (atomicWriteSize, buffer size), not %zu\n", recordLimit, messageSize);
+        return -1;
+    } // end if
+
+    PairRun run;
+    memset(&run, 0, sizeof(run));
+    run.options = options;
+    run.messageSize = messageSize;
+    run.threads = threads;
+    run.messageCount = (size_t)(options->totalBytes / messageSize / (uint64_t)threads); // the same bytes for every thread count
+    if (run.messageCount == 0U) {
+        run.messageCount = 1U;
+    } // end if
+    size_t readSize = (options->readSize < (size_t)recordLimit) ? options->readSize : (size_t)recordLimit;
+    run.recordSize = (readSize < messageSize) ? messageSize : readSize / messageSize * messageSize;
+    size_t messages = (size_t)threads * run.messageCount;
+    run.sendTimes = calloc(messages, sizeof(uint64_t));
+    run.latencies = calloc(messages, sizeof(uint64_t));
+    if (run.sendTimes == NULL || run.latencies == NULL || sem_init(&run.done, 0, 0U) != 0) {
+        fprintf(stderr, "cannot set up the run: %s\n", strerror(errno));
+        free(run.sendTimes);
+        free(run.latencies);
+        return -1;
+    } // end if
+
+    pthread_t producers[MAX_THREADS];
+    pthread_t relays[MAX_THREADS];
+    pthread_t consumers[MAX_THREADS];
+    alarm(options->timeout);
+    long switchesBefore = contextSwitches();
+    uint64_t start = nowNs();
+    for (int t = 0; t < threads; ++t) {
+        pthread_create(&consumers[t], NULL, &sharedConsumerThread, &run);
+        pthread_create(&relays[t], NULL, &sharedRelayThread, &run);
+        pthread_create(&producers[t], NULL, &sharedProducerThread, &run);
+    } // end for
+    while (sem_wait(&run.done) != 0) {
+        /* EINTR */
+    } // end while
+    uint64_t elapsed = nowNs() - start;
+    long switches = contextSwitches() - switchesBefore;
+    for (int t = 0; t < threads; ++t) { // the relays and consumers wait in read for bytes that will not come, after a failure the producers may wait in write
+        pthread_cancel(producers[t]);
+        pthread_cancel(relays[t]);
+        pthread_cancel(consumers[t]);
+    } // end for
+    for (int t = 0; t < threads; ++t) {
+        pthread_join(producers[t], NULL);
+        pthread_join(relays[t], NULL);
+        pthread_join(consumers[t], NULL);
+    } // end for
+    alarm(0U);
+
+    qsort(run.latencies, messages, sizeof(uint64_t), &compareU64);
+    double seconds = (double)elapsed / 1e9;
+    double megabytes = (double)messages * (double)messageSize / (1024.0 * 1024.0);
+    int error = run.error;
+    if (error == 0 && run.received != (uint64_t)messages * messageSize) {
+        error = EPROTO;
+    } // end if
+    printf("%s  {\"threads\": %d, \"message_size\": %zu, \"messages\": %zu, \"read_size\": %zu, \"producer\": \"shared\", \"relay\": \"shared\", "
+           "\"wakeups\": \"%s\", \"buf_size\": %ld, \"trans_offset\": %ld, \"seconds\": %.6f, "
+           "\"mb_per_s\": %.3f, \"syscalls_per_s\": %.1f, \"context_switches_per_mb\": %.3f, "
+           "\"latency_ns\": {\"p50\": %llu, \"p99\": %llu, \"p999\": %llu}, "
+           "\"verified\": %s, \"mismatched_bytes\": %llu, \"error\": \"%s\"}",
+           firstRun ? "" : ",\n", threads, messageSize, messages, run.recordSize,
+           wakeupsName(), bufSize, transOffset, seconds,
+           megabytes / seconds, (double)run.syscalls / seconds, megabytes > 0.0 ? (double)switches / megabytes : 0.0,
+           (unsigned long long)percentile(run.latencies, messages, 0.50),
+           (unsigned long long)percentile(run.latencies, messages, 0.99),
+           (unsigned long long)percentile(run.latencies, messages, 0.999),
+           (run.mismatches == 0U && error == 0) ? "true" : "false", (unsigned long long)run.mismatches,
+           error != 0 ? strerror(error) : "");
+    fflush(stdout);
+    firstRun = 0;
+    sem_destroy(&run.done);
+    free(run.sendTimes);
+    free(run.latencies);
+    return (run.mismatches == 0U && error == 0) ? 0 : -1;
+}
+
+static void usage(char const *program) {
+    fprintf(stderr, "usage: %s [--sizes 16,4096,...] [--bytes total] [--pairs n] [--read-size n] [--batch n] [--splice] [--mmap] [--transform] [--epoll] [--timeout seconds]\n"
+                    "          [--threads 1,2,4,...|scale] [--install ./install.sh [--compare-wakeups] --buf-sizes 40,4096,... --offsets 3,7,...]\n"
+                    "--install reloads the module for every bufSize/transOffset combination (needs root).\n"
+                    "Without it the loaded module is used as it is and --buf-sizes/--offsets only label the output.\n"
+                    "--compare-wakeups (needs --install) runs everything with legacyWakeups=1 and again with the split wait queues, see \"wakeups\" in the output.\n"
+                    "--batch n sends n messages per writev, one iovec segment each.\n"
+                    "--splice relays trans0 -> trans1 with splice through a pipe instead of read and write.\n"
+                    "--mmap makes the producer write into the mapped ring of trans0, see TransIoctl.h.\n"
+                    "--transform skips the queues, every pair is one thread that round trips batch messages per TRANS_IOC_TRANSFORM.\n"
+                    "--epoll makes every pair one thread that drives trans0 and trans1 with O_NONBLOCK and epoll, an EAGAIN that poll did not predict fails the run.\n"
+                    "--threads n runs n producers, n relays and n consumers on trans0 and trans1 (sharedMode=1), scale sweeps 1, 2, 4, ... up to the number of CPUs.\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    ValueList sizes = { { 16, 256, 4096, 65536 }, 4 };
+    ValueList bufSizes = { { -1 }, 1 }; // -1: whatever the loaded module uses
+    ValueList offsets = { { -1 }, 1 };
+    ValueList threads = { { 0 }, 0 };
+    LoadOptions options = { 1, DEFAULT_TOTAL_BYTES, DEFAULT_READ_SIZE, 1U, 0, 0, 0, DEFAULT_TIMEOUT, 0, 0, 0 };
+    char const *installScript = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        int hasValue = (i + 1 < argc);
+        int ok = 1;
+        if (strcmp(argv[i], "--sizes") == 0 && hasValue) {
+            ok = parseList(argv[++i], &sizes) == 0;
+        } else if (strcmp(argv[i], "--buf-sizes") == 0 && hasValue) {
+            ok = parseList(argv[++i], &bufSizes) == 0;
+        } else if (strcmp(argv[i], "--offsets") == 0 && hasValue) {
+            ok = parseList(argv[++i], &offsets) == 0;
+        } else if (strcmp(argv[i], "--bytes") == 0 && hasValue) {
+            options.totalBytes = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--read-size") == 0 && hasValue) {
+            options.readSize = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--splice") == 0) {
+            options.splice = 1;
+        } else if (strcmp(argv[i], "--mmap") == 0) {
+            options.mapped = 1;
+        } else if (strcmp(argv[i], "--transform") == 0) {
+            options.transform = 1;
+        } else if (strcmp(argv[i], "--epoll") == 0) {
+            options.epoll = 1;
+        } else if (strcmp(argv[i], "--compare-wakeups") == 0) {
+            options.compareWakeups = 1;
+        } else if (strcmp(argv[i], "--batch") == 0 && hasValue) {
+            options.batch = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--pairs") == 0 && hasValue) {
+            options.pairs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--timeout") == 0 && hasValue) {
+            options.timeout = (unsigned)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue && strcmp(argv[i + 1], "scale") == 0) {
+            ++i;
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            threads.count = 0;
+            for (long n = 1; n < cpus && threads.count < MAX_LIST - 1; n *= 2) {
+                threads.values[threads.count++] = n;
+            } // end for
+            threads.values[threads.count++] = (cpus > 1) ? cpus : 1;
+            options.shared = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            ok = parseList(argv[++i], &threads) == 0;
+            options.shared = 1;
+        } else if (strcmp(argv[i], "--install") == 0 && hasValue) {
+            installScript = argv[++i];
+        } else {
+            ok = 0;
+        } // end if
+        if (!ok) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        } // end if
+    } // end for
+    if (options.pairs < 1 || options.pairs > MAX_PAIRS || options.readSize == 0U || options.totalBytes == 0U
+        || options.batch < 1U || options.batch > MAX_BATCH
+        || (options.transform && 2U * options.batch > TRANS_TRANSFORM_MAX_SEGMENTS)
+        || (options.shared && (options.batch != 1U || options.splice || options.mapped || options.transform || options.pairs != 1))
+        || (options.epoll && (options.batch != 1U || options.splice || options.mapped || options.transform || options.shared))
+        || (options.compareWakeups && installScript == NULL)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    } // end if
+    for (int i = 0; i < sizes.count; ++i) {
+        if (sizes.values[i] <= 0) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        } // end if
+    } // end for
+    for (int i = 0; i < threads.count; ++i) {
+        if (threads.values[i] < 1 || threads.values[i] > MAX_THREADS) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        } // end if
+    } // end for
+    if (options.shared && installScript == NULL && readParameter("sharedMode", 1L) == 0L) {
+        fprintf(stderr, "--threads needs the module loaded with sharedMode=1, e.g. ./install.sh sharedMode=1\n");
+        return EXIT_FAILURE;
+    } // end if
+
+    signal(SIGALRM, &onTimeout);
+    int failed = 0;
+    printf("[\n");
+    for (int b = 0; b < bufSizes.count; ++b) {
+        for (int o = 0; o < offsets.count; ++o) {
+            for (int w = options.compareWakeups; w >= 0; --w) { // legacy first, so that the module is left with the default
+                int legacyWakeups = options.compareWakeups ? w : -1;
+                if (installScript != NULL && reloadModule(installScript, options.pairs, options.shared, bufSizes.values[b], offsets.values[o], legacyWakeups) != 0) {
+                    fprintf(stderr, "%s bufSize=%ld transOffset=%ld failed\n", installScript, bufSizes.values[b], offsets.values[o]);
+                    return EXIT_FAILURE;
+                } // end if
+                for (int s = 0; s < sizes.count; ++s) {
+                    if (options.shared) {
+                        for (int t = 0; t < threads.count; ++t) {
+                            if (runShared(&options, (size_t)sizes.values[s], (int)threads.values[t], bufSizes.values[b], offsets.values[o]) != 0) {
+                                failed = 1;
+                            } // end if
+                        } // end for threads
+                        continue;
+                    } // end if
+                    if (runOnce(&options, (size_t)sizes.values[s], bufSizes.values[b], offsets.values[o]) != 0) {
+                        failed = 1;
+                    } // end if
+                } // end for sizes
+            } // end for wakeups
+        } // end for offsets
+    } // end for bufSizes
+    printf("\n]\n");
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -2,8 +2,7 @@
 
 MODULE_LICENSE("GPL"); /* GPL license allows usage of all kernel functions. */
 MODULE_AUTHOR("CppPhil, Shryne");
-MODULE_DESCRIPTION("Two devices may be created from this kernel module. The 0th device trans0 encodes strings written to it using caesar encoding with an offset of 3. Reading from trans0 will return the encoded string. trans1 decodes strings written to it and returns the decoded strings when read from. Run install.sh as super user after compiling this kernel module to create the devices in /dev/");
-MODULE_SUPPORTED_DEVICE("none");
+MODULE_DESCRIPTION("numPairs pairs of devices are created by this kernel module. The even device of a pair, e.g. trans0, encodes strings written to it using caesar encoding with an offset of 3 by default. Reading from trans0 will return the encoded string. The odd device, e.g. trans1, decodes strings written to it and returns the decoded strings when read from. Run install.sh as super user after compiling this kernel module to load it, the devices appear in /dev/");
 
 static int majorNumber = -1; // -1 is a dummy value, this is initialized in moduleInit
 static int bufSize = BUFFERSIZE; // this may be replaced
@@ -13,31 +12,88 @@ static int transOffset = TRANS_OFFSET;
 module_param(transOffset, int, 0);
 MODULE_PARM_DESC(transOffset, "The offset by which to caesar.");
 int *pTransOffset = NULL;
+static int numPairs = NUM_PAIRS;
+module_param(numPairs, int, 0);
+MODULE_PARM_DESC(numPairs, "How many encoder/decoder pairs to create, pair i is trans(2i) and trans(2i + 1).");
+static int pairOffsets[MAX_PAIRS];
+static int pairOffsetsCount = 0;
+module_param_array(pairOffsets, int, &pairOffsetsCount, 0);
+MODULE_PARM_DESC(pairOffsets, "The offset of each pair, e.g. pairOffsets=3,7. Pairs without one use transOffset.");
+static int pairBufSizes[MAX_PAIRS];
+static int pairBufSizesCount = 0;
+module_param_array(pairBufSizes, int, &pairBufSizesCount, 0);
+MODULE_PARM_DESC(pairBufSizes, "The buffer size of both devices of each pair. Pairs without one use bufSize.");
+int sharedMode = FALSE; // also used in device.c
+module_param(sharedMode, int, 0444);
+MODULE_PARM_DESC(sharedMode, "1 lets any number of processes open a device for reading and writing at the same time.");
+int atomicWriteSize = ATOMIC_WRITE_SIZE; // also used in device.c
+module_param(atomicWriteSize, int, 0444);
+MODULE_PARM_DESC(atomicWriteSize, "Writes of up to this many bytes (and at most the buffer size) are never split or interleaved with other writers.");
+int sessionMode = FALSE; // also used in device.c
+module_param(sessionMode, int, 0444);
+MODULE_PARM_DESC(sessionMode, "1 gives every open its own queue, a client reads back what it wrote to the same file.");
+int legacyWakeups = FALSE; // also used in device.c
+module_param(legacyWakeups, int, 0444);
+MODULE_PARM_DESC(legacyWakeups, "1 wakes every sleeping reader and writer after every read and write, like the single wait queue before. For comparisons only.");
+static char *caesarImplementation = "auto";
+module_param(caesarImplementation, charp, 0444);
+MODULE_PARM_DESC(caesarImplementation, "auto uses the fastest en/decoder measured at load time, scalar, swar, sse2 or avx2 forces one, e.g. for A/B tests.");
 
 TransDevice *devices = NULL; // also used in device.c
+int numDevices = 0; // 2 * numPairs once moduleInit is done, also used in device.c and stats.c
+static struct class *transClass = NULL; // makes udev create /dev/trans*
+static int nodesCreated = 0;
 char *alphabet = NULL; // also used in caesar.c
 size_t const alphBufSiz = (CHARS_IN_ALPHABET * 2) + 2; // 26 * 2 == 52 (26 lower and upper case letters each); + 2: 1 for the '\0' and and for ' '; also used in caesar.c
 
 static struct file_operations fops = { /* set up the file opecations */
     .owner = THIS_MODULE,
-    .read = &transDeviceRead,
+    .read_iter = &transDeviceRead, /* read and readv, one pass over all segments */
     .open = &transDeviceOpen,
     .release = &transDeviceClose,
-    .write = &transDeviceWrite,
+    .write_iter = &transDeviceWrite, /* write and writev */
+    .poll = &transDevicePoll,
+    .splice_write = &iter_file_splice_write, /* splice and sendfile into trans0/1, the pipe pages go through write_iter without a copy to user space */
+    .splice_read = &TRANS_SPLICE_READ, /* splice out of trans0/1, see Header.h */
+    .mmap = &transDeviceMmap, /* the ring itself, see TransIoctl.h */
+    .unlocked_ioctl = &transDeviceIoctl,
+    .compat_ioctl = TRANS_COMPAT_IOCTL, /* the structures in TransIoctl.h look the same to 32 bit user space */
 };
 
+static char *transDevnode(TRANS_DEVNODE_CONST struct device *node, umode_t *mode) { // everybody may use the devices, like install.sh always did
+    if (mode != NULL) {
+        *mode = 0666;
+    } // end if
+    return NULL; // the default name
+}
+
 static int __init moduleInit(void) {
     int errorCode = -1;
-    if (bufSize <= 0) {
-        PRINT_DEBUG("bufSize is not large enough, it was 0 or less.\n");
+    if (numPairs <= 0 || numPairs > MAX_PAIRS) {
+        PRINT_ERROR("numPairs must be between 1 and %d, it was %d.\n", MAX_PAIRS, numPairs);
+        return -EINVAL;
     } // end if
-    
-    int retVal = register_chrdev(MAJOR_NUMBER, DRIVER_NAME, &fops); // since a dynamic major number is used this returns 0 on error and the major number on success.
-    if (retVal == 0) {
-        PRINT_DEBUG("register_chrdev failed.\n");
-        return -EIO;
+    if (sharedMode && sessionMode) {
+        PRINT_ERROR("sharedMode and sessionMode exclude each other.\n");
+        return -EINVAL;
     } // end if
-    majorNumber = retVal; // set the global majorNumber to the major number we got from the system
+    if (atomicWriteSize < 0) {
+        PRINT_ERROR("atomicWriteSize must not be negative, it was %d.\n", atomicWriteSize);
+        return -EINVAL;
+    } // end if
+    BOOL const forceImplementation = strcmp(caesarImplementation, "auto") != 0;
+    int const forcedImplementation = findCaesarImplementation(caesarImplementation);
+    if (forceImplementation && (forcedImplementation < 0 || !caesarImplementationAvailable((CaesarImplementation)forcedImplementation))) {
+        PRINT_ERROR("caesarImplementation must be auto or one of scalar, swar, sse2 and avx2 that this CPU supports, it was %s.\n", caesarImplementation);
+        return -EINVAL;
+    } // end if
+    for (int pair = 0; pair < numPairs; ++pair) {
+        int pairBufSize = (pair < pairBufSizesCount) ? pairBufSizes[pair] : bufSize;
+        if (pairBufSize <= 0) {
+            PRINT_ERROR("the buffer size of pair %d is not large enough, it was 0 or less.\n", pair);
+            return -EINVAL;
+        } // end if
+    } // end for
     
     pTransOffset = HEAP_ALLOC8(sizeof(int) * 1U);
     if (pTransOffset == NULL) {
@@ -47,13 +103,14 @@ static int __init moduleInit(void) {
     }
     *pTransOffset = transOffset;
     
-    devices = HEAP_ALLOC8(sizeof(TransDevice) * NUM_DEVICES);
+    devices = HEAP_ALLOC8(sizeof(TransDevice) * 2U * (size_t)numPairs);
     
     if (devices == NULL) {
         PRINT_DEBUG("Failed to allocate memory for the devices\n");
         errorCode = -ENOMEM;
         goto error;
     } // end if
+    numDevices = 2 * numPairs; // moduleExit copes with devices that were not set up yet, they are still zeroed.
     
     alphabet = HEAP_ALLOC8(sizeof(char) * alphBufSiz);
 
@@ -63,15 +120,98 @@ static int __init moduleInit(void) {
         goto error;
     }
     
-    strcpy(alphabet, "ABCDEFGHIJKLMNOPQRSTUVWXYZ abcdefghijklmnopqrstuvwxyz");
+    strcpy(alphabet, CAESAR_ALPHABET);
+    errorCode = selectCaesarImplementation(); // a short benchmark of every en/decoder this CPU can run, like raid6 and xor pick their routines
+    if (errorCode != EXIT_OK) {
+        goto error;
+    } // end if
+    for (int i = 0; i < CAESAR_IMPLEMENTATIONS; ++i) {
+        if (caesarImplementationAvailable((CaesarImplementation)i)) {
+            PRINT_INFO("caesar %-6s %5u MB/s\n", caesarImplementationNames[i], caesarImplementationThroughput((CaesarImplementation)i));
+        } // end if
+    } // end for
+    if (forceImplementation) {
+        setCaesarImplementation((CaesarImplementation)forcedImplementation); // available, checked above
+    } // end if
+    PRINT_INFO("using caesar %s%s\n", caesarImplementationNames[getCaesarImplementation()], forceImplementation ? " (caesarImplementation)" : "");
     
-    for (ssize_t i = 0; i < NUM_DEVICES; ++i) {
-        sema_init(&devices[i].sem, 1);
-        init_waitqueue_head(&devices[i].q);
-        devices[i].string = createString();
-        devices[i].string.PRIVATEchangeCapacity(&devices[i].string, (string_size_type)bufSize);
-        devices[i].maxBufSize = bufSize;
+    for (ssize_t i = 0; i < 2 * numPairs; ++i) {
+        int pair = (int)i / 2;
+        int offset = (pair < pairOffsetsCount) ? pairOffsets[pair] : *pTransOffset; // both devices of a pair share it, so that the decoder undoes the encoder.
+        int pairBufSize = (pair < pairBufSizesCount) ? pairBufSizes[pair] : bufSize;
+        devices[i].minorNumber = (int)i;
+        devices[i].encoder = (i % 2) == 0;
+        mutex_init(&devices[i].readLock);
+        mutex_init(&devices[i].writeLock);
+        mutex_init(&devices[i].configLock);
+        init_waitqueue_head(&devices[i].readq);
+        init_waitqueue_head(&devices[i].writeq);
+        atomic_set(&devices[i].mappings, 0);
+        atomic_set(&devices[i].transformRequested, 0);
+        devices[i].ring = createRingBuffer((ring_size_type)pairBufSize);
+        if (devices[i].ring.capacity(&devices[i].ring) == 0U) {
+            PRINT_DEBUG("Failed to allocate memory for the ring buffer of device %d\n", (int)i);
+            errorCode = -ENOMEM;
+            goto error;
+        } // end if
+        errorCode = transDeviceSetOffset(&devices[i], offset); // precompute the translation once, so that en/decoding costs one lookup per character regardless of the offset.
+        if (errorCode != EXIT_OK) {
+            PRINT_DEBUG("Failed to allocate the caesar table of device %d\n", (int)i);
+            goto error;
+        } // end if
+        errorCode = initStats(&devices[i].stats);
+        if (errorCode != EXIT_OK) {
+            PRINT_DEBUG("Failed to allocate the statistics of device %d\n", (int)i);
+            goto error;
+        } // end if
     } // end for    
+    
+    errorCode = createStatsProcEntry();
+    if (errorCode != EXIT_OK) {
+        goto error;
+    } // end if
+    errorCode = createScratchPool(numDevices); // one TRANS_IOC_TRANSFORM per device can always run, whatever the system's memory looks like
+    if (errorCode != EXIT_OK) {
+        goto error;
+    } // end if
+    if (sessionMode) {
+        errorCode = createSessionCache();
+        if (errorCode != EXIT_OK) {
+            goto error;
+        } // end if
+    } // end if
+    
+    int retVal = register_chrdev(MAJOR_NUMBER, DRIVER_NAME, &fops); /* since a dynamic major number is used this returns 0 on error and the major number on success.
+        Only now that every device is set up, so that an open can never see one that is not. */
+    if (retVal <= 0) {
+        PRINT_ERROR("register_chrdev failed.\n");
+        errorCode = (retVal < 0) ? retVal : -EIO;
+        goto error;
+    } // end if
+    majorNumber = retVal; // set the global majorNumber to the major number we got from the system
+    
+    transClass = TRANS_CLASS_CREATE(DRIVER_NAME);
+    if (IS_ERR(transClass)) {
+        PRINT_ERROR("class_create failed.\n");
+        errorCode = PTR_ERR(transClass);
+        transClass = NULL;
+        goto error;
+    } // end if
+    transClass->devnode = &transDevnode;
+    errorCode = createClassFiles(transClass); // caesar_implementation and caesar_throughput, see sysfs.c
+    if (errorCode != EXIT_OK) {
+        PRINT_ERROR("class_create_file failed.\n");
+        goto error;
+    } // end if
+    for (int i = 0; i < numDevices; ++i) { // the nodes go last, nobody can open a device before it is set up.
+        struct device *node = device_create_with_groups(transClass, NULL, MKDEV(majorNumber, i), &devices[i], transDeviceGroups, "trans%d", i); // with offset and capacity, see sysfs.c
+        if (IS_ERR(node)) {
+            PRINT_ERROR("device_create failed for trans%d.\n", i);
+            errorCode = PTR_ERR(node);
+            goto error;
+        } // end if
+        nodesCreated = i + 1;
+    } // end for
     return EXIT_OK;
     
 error:
@@ -81,18 +221,38 @@ error:
 
 static void moduleExit(void) {
     PRINT_DEBUG("moduleExit called\n");
-    kfree(pTransOffset);
-    if (devices == NULL) {
-        return;
+    for (int i = 0; i < nodesCreated; ++i) {
+        device_destroy(transClass, MKDEV(majorNumber, i));
+    } // end for
+    nodesCreated = 0;
+    if (transClass != NULL) {
+        removeClassFiles(transClass); // fine for files that were never created
+        class_destroy(transClass);
+        transClass = NULL;
     } // end if
+    if (majorNumber > 0) {
+        unregister_chrdev(majorNumber,
+                          DRIVER_NAME);
+        majorNumber = -1;
+    } // end if
+    removeStatsProcEntry(); // fine if it was never created
+    destroySessionCache(); // every session was closed, the module can not be unloaded while a file is open
+    destroyScratchPool();
+    kfree(pTransOffset);
     
-    for (ssize_t i = 0; i < NUM_DEVICES; ++i) {
-        devices[i].string.destructor(&devices[i].string); // free all the buffers of all the devices
-    } // end for
+    if (devices != NULL) {
+        for (ssize_t i = 0; i < numDevices; ++i) {
+            if (devices[i].ring.destructor != NULL) { // moduleInit may have failed before this device was set up
+                devices[i].ring.destructor(&devices[i].ring); // free all the buffers of all the devices
+            } // end if
+            destroyStats(&devices[i].stats);
+            kfree(rcu_dereference_protected(devices[i].table, TRUE)); // the nodes are gone, nobody changes the offset any more
+        } // end for
+    } // end if
     kfree(devices); // free the devices
+    devices = NULL;
+    numDevices = 0;
     kfree(alphabet);
-    unregister_chrdev(majorNumber,
-                      DRIVER_NAME);
 } // end moduleExit
 
 module_init(moduleInit);
@@ -0,0 +1,244 @@
+#include "Ring.h"
+
+#define ZERO    (ring_size_type)0U
+
+static void destructor(struct RingBuffer_ *ring);
+static ring_size_type size(struct RingBuffer_ const *ring);
+static ring_size_type capacity(struct RingBuffer_ const *ring);
+static ring_size_type freeSpace(struct RingBuffer_ const *ring);
+static BOOL isEmpty(struct RingBuffer_ const *ring);
+static BOOL isFull(struct RingBuffer_ const *ring);
+static ring_size_type produce(struct RingBuffer_ *ring, ring_value_type const *source, ring_size_type count);
+static ring_size_type consume(struct RingBuffer_ *ring, ring_value_type *destination, ring_size_type count);
+static ring_size_type reserveWrite(struct RingBuffer_ *ring, ring_value_type **span, ring_size_type count);
+static ring_size_type reserveWriteAfter(struct RingBuffer_ *ring, ring_value_type **span, ring_size_type reserved, ring_size_type count);
+static void commitWrite(struct RingBuffer_ *ring, ring_size_type count);
+static ring_size_type reserveRead(struct RingBuffer_ *ring, ring_value_type const **span, ring_size_type count);
+static void commitRead(struct RingBuffer_ *ring, ring_size_type count);
+static ring_size_type reserveMapped(struct RingBuffer_ *ring, ring_value_type **span);
+static TransRingControl *control(struct RingBuffer_ *ring);
+static ring_size_type mapSize(struct RingBuffer_ const *ring);
+static int resize(struct RingBuffer_ *ring, ring_size_type maxBytes);
+static RingBuffer createRing(ring_size_type maxBytes, BOOL mappable);
+static void freeStorage(TransRingControl *control, BOOL mappable);
+
+RingBuffer createRingBuffer(ring_size_type maxBytes) {
+    return createRing(maxBytes, TRUE);
+}
+
+RingBuffer createPrivateRingBuffer(ring_size_type maxBytes) {
+    return createRing(maxBytes, FALSE);
+}
+
+static RingBuffer createRing(ring_size_type maxBytes, BOOL mappable) {
+    RingBuffer ring;
+    // public begin
+    ring.destructor = &destructor;
+    ring.size = &size;
+    ring.capacity = &capacity;
+    ring.freeSpace = &freeSpace;
+    ring.isEmpty = &isEmpty;
+    ring.isFull = &isFull;
+    ring.produce = &produce;
+    ring.consume = &consume;
+    ring.reserveWrite = &reserveWrite;
+    ring.reserveWriteAfter = &reserveWriteAfter;
+    ring.commitWrite = &commitWrite;
+    ring.reserveRead = &reserveRead;
+    ring.commitRead = &commitRead;
+    ring.reserveMapped = &reserveMapped;
+    ring.control = &control;
+    ring.mapSize = &mapSize;
+    ring.resize = &resize;
+    // public end
+
+    // private begin
+    // data members begin
+    ring.PRIVATEcontrol_ = NULL;
+    ring.PRIVATEdata_ = NULL;
+    ring.PRIVATEcapacity_ = ZERO;
+    ring.PRIVATEmask_ = ZERO;
+    ring.PRIVATEmappable_ = mappable;
+    // data members end
+    // private end
+
+    if (maxBytes == ZERO || maxBytes > RING_MAX_CAPACITY) {
+        PRINT_DEBUG("Attempted to create a RingBuffer with a capacity of %zu in %s.\n", maxBytes, __FUNCTION__);
+        return ring;
+    } // end if
+    ring_size_type storageSize = roundup_pow_of_two(maxBytes);
+    ring_size_type dataOffset = mappable ? PAGE_SIZE : sizeof(TransRingControl); // the data area of a mapping has to start on a page of its own
+    if (mappable) {
+        ring.PRIVATEcontrol_ = vmalloc_user(dataOffset + storageSize * sizeof(ring_value_type)); // zeroed and page aligned, so that it may be mapped into user space.
+    } else {
+        ring.PRIVATEcontrol_ = kvzalloc(dataOffset + storageSize * sizeof(ring_value_type), GFP_KERNEL); // small rings come from the slab, no vmalloc area is used up.
+    } // end if
+    if (ring.PRIVATEcontrol_ == NULL) {
+        PRINT_DEBUG("Allocating %zu bytes of ring storage failed in %s.\n", storageSize, __FUNCTION__);
+        return ring;
+    } // end if
+    ring.PRIVATEdata_ = (ring_value_type *)ring.PRIVATEcontrol_ + dataOffset;
+    ring.PRIVATEcapacity_ = maxBytes;
+    ring.PRIVATEmask_ = storageSize - 1U;
+    ring.PRIVATEcontrol_->capacity = (__u32)maxBytes;
+    ring.PRIVATEcontrol_->dataSize = (__u32)storageSize;
+    ring.PRIVATEcontrol_->dataOffset = (__u32)dataOffset;
+    return ring;
+}
+
+static void freeStorage(TransRingControl *control, BOOL mappable) {
+    if (mappable) {
+        vfree(control);
+    } else {
+        kvfree(control);
+    } // end if
+}
+
+static void destructor(struct RingBuffer_ *ring) {
+    freeStorage(ring->PRIVATEcontrol_, ring->PRIVATEmappable_);
+    ring->PRIVATEcontrol_ = NULL;
+    ring->PRIVATEdata_ = NULL;
+    ring->PRIVATEcapacity_ = ZERO;
+    ring->PRIVATEmask_ = ZERO;
+}
+
+static ring_size_type size(struct RingBuffer_ const *ring) { // safe without the producer's or the consumer's lock, even while resize swaps the storage.
+    rcu_read_lock();
+    TransRingControl const *control = rcu_dereference(ring->PRIVATEcontrol_);
+    ring_index_type tail = smp_load_acquire(&control->tail); // load tail first, so that head can never be older than tail and the difference can not wrap.
+    ring_index_type head = smp_load_acquire(&control->head);
+    rcu_read_unlock();
+    ring_size_type used = (ring_index_type)(head - tail); // the indices are free running, unsigned wrap around keeps the difference correct.
+    return min(used, ring->capacity(ring)); /* the producer and the consumer always get the exact value, an observer on a third thread may see both sides move and gets a bounded estimate.
+        The clamp also keeps a mapped consumer that stores garbage into tail from making us read or write outside of the storage. */
+}
+
+static ring_size_type capacity(struct RingBuffer_ const *ring) {
+    return READ_ONCE(ring->PRIVATEcapacity_);
+}
+
+static ring_size_type freeSpace(struct RingBuffer_ const *ring) {
+    return ring->capacity(ring) - ring->size(ring);
+}
+
+static BOOL isEmpty(struct RingBuffer_ const *ring) {
+    return ring->size(ring) == ZERO;
+}
+
+static BOOL isFull(struct RingBuffer_ const *ring) {
+    return ring->size(ring) >= ring->capacity(ring);
+}
+
+static ring_size_type produce(struct RingBuffer_ *ring, ring_value_type const *source, ring_size_type count) {
+    count = min(count, ring->freeSpace(ring)); // never overwrite bytes that were not consumed yet. Acquiring tail_ in there orders the consumer's reads before our writes.
+    ring_index_type head = ring->PRIVATEcontrol_->head; // only the producer writes head
+    ring_size_type offset = head & ring->PRIVATEmask_;
+    ring_size_type untilWrap = min(count, ring->PRIVATEmask_ + 1U - offset); // the part that fits before the end of the storage
+    memcpy(ring->PRIVATEdata_ + offset, source, untilWrap * sizeof(ring_value_type));
+    memcpy(ring->PRIVATEdata_, source + untilWrap, (count - untilWrap) * sizeof(ring_value_type)); // the rest wraps around to the beginning
+    smp_store_release(&ring->PRIVATEcontrol_->head, (ring_index_type)(head + count)); // publish the bytes only after they were copied.
+    return count;
+}
+
+static ring_size_type consume(struct RingBuffer_ *ring, ring_value_type *destination, ring_size_type count) {
+    count = min(count, ring->size(ring)); // acquiring head_ in there makes the producer's bytes visible to us.
+    ring_index_type tail = ring->PRIVATEcontrol_->tail; // only the consumer writes tail
+    ring_size_type offset = tail & ring->PRIVATEmask_;
+    ring_size_type untilWrap = min(count, ring->PRIVATEmask_ + 1U - offset);
+    memcpy(destination, ring->PRIVATEdata_ + offset, untilWrap * sizeof(ring_value_type));
+    memcpy(destination + untilWrap, ring->PRIVATEdata_, (count - untilWrap) * sizeof(ring_value_type));
+    smp_store_release(&ring->PRIVATEcontrol_->tail, (ring_index_type)(tail + count)); // hand the space back only after the bytes were copied out.
+    return count;
+}
+
+static ring_size_type reserveWrite(struct RingBuffer_ *ring, ring_value_type **span, ring_size_type count) { // lets the producer fill the free space in place, nothing is visible to the consumer until commitWrite.
+    return ring->reserveWriteAfter(ring, span, ZERO, count);
+}
+
+static ring_size_type reserveWriteAfter(struct RingBuffer_ *ring, ring_value_type **span, ring_size_type reserved, ring_size_type count) { /* like reserveWrite, but behind reserved bytes
+    * that were reserved and filled before and are not committed yet. This way the part that wraps around can be filled too and everything is published with one commitWrite.
+    */
+    ring_size_type available = ring->freeSpace(ring);
+    if (reserved >= available) {
+        return ZERO;
+    } // end if
+    count = min(count, available - reserved);
+    ring_size_type offset = (ring->PRIVATEcontrol_->head + reserved) & ring->PRIVATEmask_;
+    count = min(count, ring->PRIVATEmask_ + 1U - offset); // only the contiguous part, call again for the part that wraps around.
+    *span = ring->PRIVATEdata_ + offset;
+    return count;
+}
+
+static void commitWrite(struct RingBuffer_ *ring, ring_size_type count) { // count must not exceed what was reserved since the last commitWrite.
+    smp_store_release(&ring->PRIVATEcontrol_->head, (ring_index_type)(ring->PRIVATEcontrol_->head + count));
+}
+
+static ring_size_type reserveRead(struct RingBuffer_ *ring, ring_value_type const **span, ring_size_type count) { // lets the consumer copy the queued bytes out in place, the space is not handed back until commitRead.
+    count = min(count, ring->size(ring)); // acquiring head_ in there makes the producer's bytes visible to us.
+    ring_size_type offset = ring->PRIVATEcontrol_->tail & ring->PRIVATEmask_;
+    count = min(count, ring->PRIVATEmask_ + 1U - offset); // only the contiguous part, call again after commitRead for the part that wraps around.
+    *span = ring->PRIVATEdata_ + offset;
+    return count;
+}
+
+static void commitRead(struct RingBuffer_ *ring, ring_size_type count) { // count must not exceed what the last reserveRead returned.
+    smp_store_release(&ring->PRIVATEcontrol_->tail, (ring_index_type)(ring->PRIVATEcontrol_->tail + count));
+}
+
+static ring_size_type reserveMapped(struct RingBuffer_ *ring, ring_value_type **span) { /* the contiguous part of what a mapped producer wrote between head and produced,
+    * call commitWrite after transforming it. produced comes from user space: if it claims more than there is free space nothing is reserved.
+    */
+    ring_index_type produced = smp_load_acquire(&ring->PRIVATEcontrol_->produced); // pairs with the producer's store release, its bytes are visible after this.
+    ring_size_type pending = (ring_index_type)(produced - ring->PRIVATEcontrol_->head);
+    if (pending > ring->freeSpace(ring)) {
+        return ZERO;
+    } // end if
+    return ring->reserveWrite(ring, span, pending);
+}
+
+static TransRingControl *control(struct RingBuffer_ *ring) { // the start of the mappable area
+    return ring->PRIVATEcontrol_;
+}
+
+static ring_size_type mapSize(struct RingBuffer_ const *ring) { // the control page and the storage, in whole pages. 0 if the ring can not be mapped.
+    if (!ring->PRIVATEmappable_) {
+        return ZERO;
+    } // end if
+    return PAGE_ALIGN(PAGE_SIZE + ring->PRIVATEmask_ + 1U);
+}
+
+static int resize(struct RingBuffer_ *ring, ring_size_type maxBytes) { /* moves the queued bytes into new storage of maxBytes.
+    * Neither the producer nor the consumer may be active, the caller holds both of their locks. Observers that only call size,
+    * capacity, isEmpty or isFull may keep going, they see the old or the new ring and the old storage is freed after an RCU grace period.
+    */
+    if (maxBytes == ZERO || maxBytes > RING_MAX_CAPACITY) {
+        return -EINVAL;
+    } // end if
+    ring_size_type used = ring->size(ring);
+    if (used > maxBytes) { // the queued bytes must survive
+        return -ENOSPC;
+    } // end if
+    RingBuffer resized = createRing(maxBytes, ring->PRIVATEmappable_);
+    if (resized.PRIVATEcontrol_ == NULL) {
+        return -ENOMEM;
+    } // end if
+    ring_size_type tail = ring->PRIVATEcontrol_->tail & ring->PRIVATEmask_; // copy like consume does, but leave the old ring as it is for the observers.
+    ring_size_type untilWrap = min(used, ring->PRIVATEmask_ + 1U - tail);
+    memcpy(resized.PRIVATEdata_, ring->PRIVATEdata_ + tail, untilWrap * sizeof(ring_value_type));
+    memcpy(resized.PRIVATEdata_ + untilWrap, ring->PRIVATEdata_, (used - untilWrap) * sizeof(ring_value_type));
+    resized.PRIVATEcontrol_->head = (ring_index_type)used;
+    
+    TransRingControl *old = ring->PRIVATEcontrol_;
+    ring->PRIVATEdata_ = resized.PRIVATEdata_;
+    ring->PRIVATEmask_ = resized.PRIVATEmask_;
+    if (maxBytes < ring->PRIVATEcapacity_) { // publish the smaller capacity before the new storage, an observer never sees more queued bytes than the capacity allows.
+        WRITE_ONCE(ring->PRIVATEcapacity_, maxBytes);
+        rcu_assign_pointer(ring->PRIVATEcontrol_, resized.PRIVATEcontrol_);
+    } else {
+        rcu_assign_pointer(ring->PRIVATEcontrol_, resized.PRIVATEcontrol_);
+        WRITE_ONCE(ring->PRIVATEcapacity_, maxBytes);
+    } // end if
+    synchronize_rcu(); // no observer uses the old control page any more after this.
+    freeStorage(old, ring->PRIVATEmappable_);
+    return EXIT_OK;
+}
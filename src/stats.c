@@ -0,0 +1,164 @@
+#include "Stats.h"
+#include "Device.h"
+
+extern TransDevice *devices; // from module.c
+extern int numDevices; // from module.c
+
+static struct proc_dir_entry *statsProcEntry = NULL;
+
+static unsigned int histogramBucket(u64 nanoseconds);
+static void sumCounters(TransStats const *stats, TransStatsCounters *sum);
+static void showHistogram(struct seq_file *file, char const *name, u64 const *histogram);
+static int showStats(struct seq_file *file, void *unused);
+static int openStats(struct inode *inode, struct file *file);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 6, 0)
+static struct proc_ops const statsProcOps = {
+    .proc_open = &openStats,
+    .proc_read = &seq_read,
+    .proc_lseek = &seq_lseek,
+    .proc_release = &single_release,
+};
+#else
+static struct file_operations const statsProcOps = {
+    .owner = THIS_MODULE,
+    .open = &openStats,
+    .read = &seq_read,
+    .llseek = &seq_lseek,
+    .release = &single_release,
+};
+#endif
+
+int initStats(TransStats *stats) {
+    stats->counters = alloc_percpu(TransStatsCounters); // zeroed
+    if (stats->counters == NULL) {
+        PRINT_DEBUG("alloc_percpu failed in %s\n", __FUNCTION__);
+        return -ENOMEM;
+    } // end if
+    stats->highWaterMark = 0U;
+    return EXIT_OK;
+}
+
+void destroyStats(TransStats *stats) {
+    free_percpu(stats->counters); // NULL is fine
+    stats->counters = NULL;
+}
+
+u64 statsNow(void) {
+    return ktime_to_ns(ktime_get());
+}
+
+static unsigned int histogramBucket(u64 nanoseconds) {
+    if (nanoseconds == 0U) {
+        return 0U;
+    } // end if
+    return min_t(unsigned int, ilog2(nanoseconds), STATS_HISTOGRAM_BUCKETS - 1);
+}
+
+void statsRecordWrite(TransStats *stats, ssize_t result, u64 startNs) {
+    this_cpu_inc(stats->counters->writeCalls);
+    this_cpu_inc(stats->counters->writeLatencyHistogram[histogramBucket(statsNow() - startNs)]);
+    if (result > 0) {
+        this_cpu_add(stats->counters->bytesIn, (u64)result);
+    } // end if
+}
+
+void statsRecordQueued(TransStats *stats, size_t queued) { // right after a commitWrite, before a reader can take the bytes away. The caller holds writeLock.
+    if (queued > READ_ONCE(stats->highWaterMark)) {
+        WRITE_ONCE(stats->highWaterMark, queued); // READ_ONCE in the proc file
+    } // end if
+}
+
+void statsRecordRead(TransStats *stats, ssize_t result, u64 startNs) {
+    this_cpu_inc(stats->counters->readCalls);
+    this_cpu_inc(stats->counters->readLatencyHistogram[histogramBucket(statsNow() - startNs)]);
+    if (result > 0) {
+        this_cpu_add(stats->counters->bytesOut, (u64)result);
+    } // end if
+}
+
+void statsRecordBlocked(TransStats *stats, BOOL writer, u64 startNs) {
+    if (writer) {
+        this_cpu_inc(stats->counters->writerBlocked);
+    } else {
+        this_cpu_inc(stats->counters->readerBlocked);
+    } // end if
+    this_cpu_inc(stats->counters->blockedHistogram[histogramBucket(statsNow() - startNs)]);
+}
+
+void statsRecordBusy(TransStats *stats) {
+    this_cpu_inc(stats->counters->busyRejections);
+}
+
+static void sumCounters(TransStats const *stats, TransStatsCounters *sum) { // only the reader of the proc file pays for adding up the CPUs.
+    memset(sum, 0, sizeof(*sum));
+    int cpu;
+    for_each_possible_cpu(cpu) {
+        TransStatsCounters const *counters = per_cpu_ptr(stats->counters, cpu);
+        sum->bytesIn += counters->bytesIn;
+        sum->bytesOut += counters->bytesOut;
+        sum->writeCalls += counters->writeCalls;
+        sum->readCalls += counters->readCalls;
+        sum->busyRejections += counters->busyRejections;
+        sum->writerBlocked += counters->writerBlocked;
+        sum->readerBlocked += counters->readerBlocked;
+        for (size_t i = 0U; i < STATS_HISTOGRAM_BUCKETS; ++i) {
+            sum->blockedHistogram[i] += counters->blockedHistogram[i];
+            sum->writeLatencyHistogram[i] += counters->writeLatencyHistogram[i];
+            sum->readLatencyHistogram[i] += counters->readLatencyHistogram[i];
+        } // end for
+    } // end for_each_possible_cpu
+}
+
+static void showHistogram(struct seq_file *file, char const *name, u64 const *histogram) { // one line, the i-th number is the bucket of [2^i, 2^(i + 1)) ns
+    seq_printf(file, "  %s_ns_log2", name);
+    for (size_t i = 0U; i < STATS_HISTOGRAM_BUCKETS; ++i) {
+        seq_printf(file, " %llu", (unsigned long long)histogram[i]);
+    } // end for
+    seq_putc(file, '\n');
+}
+
+static int showStats(struct seq_file *file, void *unused) {
+    TransStatsCounters *sum = kmalloc(sizeof(*sum), GFP_KERNEL); // too large for the kernel stack
+    if (sum == NULL) {
+        return -ENOMEM;
+    } // end if
+    for (int i = 0; i < numDevices; ++i) {
+        TransDevice *device = &devices[i];
+        sumCounters(&device->stats, sum);
+        seq_printf(file, "trans%d:\n", i);
+        seq_printf(file, "  bytes_in %llu\n", (unsigned long long)sum->bytesIn);
+        seq_printf(file, "  bytes_out %llu\n", (unsigned long long)sum->bytesOut);
+        seq_printf(file, "  write_calls %llu\n", (unsigned long long)sum->writeCalls);
+        seq_printf(file, "  read_calls %llu\n", (unsigned long long)sum->readCalls);
+        seq_printf(file, "  busy_rejections %llu\n", (unsigned long long)sum->busyRejections);
+        seq_printf(file, "  writer_blocked %llu\n", (unsigned long long)sum->writerBlocked);
+        seq_printf(file, "  reader_blocked %llu\n", (unsigned long long)sum->readerBlocked);
+        seq_printf(file, "  queue_depth %zu\n", device->ring.size(&device->ring));
+        seq_printf(file, "  queue_capacity %zu\n", device->ring.capacity(&device->ring));
+        seq_printf(file, "  high_water_mark %zu\n", READ_ONCE(device->stats.highWaterMark));
+        showHistogram(file, "blocked", sum->blockedHistogram);
+        showHistogram(file, "write", sum->writeLatencyHistogram);
+        showHistogram(file, "read", sum->readLatencyHistogram);
+    } // end for
+    kfree(sum);
+    return EXIT_OK;
+}
+
+static int openStats(struct inode *inode, struct file *file) {
+    return single_open(file, &showStats, NULL);
+}
+
+int createStatsProcEntry(void) {
+    statsProcEntry = proc_create(STATS_PROC_NAME, 0444, NULL, &statsProcOps);
+    if (statsProcEntry == NULL) {
+        PRINT_DEBUG("proc_create failed in %s\n", __FUNCTION__);
+        return -ENOMEM;
+    } // end if
+    return EXIT_OK;
+}
+
+void removeStatsProcEntry(void) {
+    proc_remove(statsProcEntry); // NULL is fine
+    statsProcEntry = NULL;
+}
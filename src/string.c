@@ -1,6 +1,6 @@
 #include "String.h"
 
-#define STRING_GROWTH_FACTOR    (string_size_type)2U
+#define STRING_MAX_CAPACITY (string_size_type)(KMALLOC_MAX_SIZE - 1U) /* the largest buffer krealloc can hand out, minus the '\0' */
 
 #define ZERO    (string_size_type)0U
 #define ONE     (string_size_type)1U
@@ -46,7 +46,13 @@ static void ensureNotNull(struct String_ const *string, const char *functionName
 static void pushFront(struct String_ *receiver, string_value_type theChar);
 static void prepend(struct String_ *receiver, string_value_type const *str);
 static string_value_type popFront(struct String_ *receiver);
-static void *myRealloc(void *ptr, size_t oldSize, size_t newSize);
+static void appendBytes(struct String_ *string, string_value_type const *bytes, string_size_type length);
+static string_size_type consume(struct String_ *string, string_size_type count);
+static string_size_type peek(struct String_ const *string, string_value_type *destination, string_size_type count);
+static StringView view(struct String_ const *string);
+static void setMaxCapacity(struct String_ *string, string_size_type maxCapacity);
+static string_size_type PRIVATEsizeClass(struct String_ const *string, string_size_type required);
+static void *myRealloc(void *ptr, size_t newSize);
 static void assertTrue(BOOL boolean, char const *funcName);
 
 String createString(void) {
@@ -78,6 +84,11 @@ String createString(void) {
     str.pushFront = &pushFront;
     str.prepend = &prepend;
     str.popFront = &popFront;
+    str.appendBytes = &appendBytes;
+    str.consume = &consume;
+    str.peek = &peek;
+    str.view = &view;
+    str.setMaxCapacity = &setMaxCapacity;
     // public end
 
     // private begin
@@ -90,13 +101,14 @@ String createString(void) {
     str.PRIVATEcanBeAppended = &PRIVATEcanBeAppended;
     str.PRIVATEfits = &PRIVATEfits;
     str.PRIVATEgrowToFit = &PRIVATEgrowToFit;
+    str.PRIVATEsizeClass = &PRIVATEsizeClass;
 
     // data members begin
     str.PRIVATEdata_ = p;
     str.PRIVATEcapacity_ = ZERO;
     str.PRIVATEsize_ = ZERO;
     str.PRIVATEwasFreed_ = false;
-    str.PRIVATEgrowthFactor = STRING_GROWTH_FACTOR;
+    str.PRIVATEmaxCapacity_ = STRING_MAX_CAPACITY;
     // data member end
 
     // private end
@@ -128,14 +140,15 @@ static void PRIVATEchangeCapacity(struct String_ *string, string_size_type newCa
         PRINT_DEBUG("data_ in string was NULL in %s this would behave like a call to malloc and is most likely unintended.\n", __FUNCTION__);
         return;
     }
-    string_value_type *ret = (string_value_type *)myRealloc(string->PRIVATEdata_, string->PRIVATEcapacity_ + ONE, newCapacity + ONE);
+    string_value_type *ret = (string_value_type *)myRealloc(string->PRIVATEdata_, newCapacity + ONE);
     if (ret == NULL) {
         PRINT_DEBUG("Failed to allocate memory in %s\n", __FUNCTION__);
         return;
     }
     string->PRIVATEdata_ = ret;
     string->PRIVATEcapacity_ = newCapacity;
-    string->PRIVATEdata_[newCapacity] = '\0';
+    string->PRIVATEsize_ = min(string->PRIVATEsize_, newCapacity);
+    string->PRIVATEdata_[string->PRIVATEsize_] = '\0'; // the new bytes are not zeroed, only the terminator is needed
 }
 
 static void PRIVATEexpandCapacity(struct String_ *string, string_size_type growBy) {
@@ -154,8 +167,7 @@ static void PRIVATEprintStatus(struct String_ const *string) {
                 string->PRIVATEwasFreed_ ? "true" : "false"
                );
     PRINT_DEBUG("Hex dump:");
-    string_size_type strl = strlen(string->PRIVATEdata_);
-    for (string_size_type i = ZERO; i < strl; ++i) {
+    for (string_size_type i = ZERO; i < string->PRIVATEsize_; ++i) { // all of it, the content may contain '\0'
         PRINT_DEBUG("%x", string->PRIVATEdata_[i]);
     }
     PRINT_DEBUG("%s", "\n\n");
@@ -211,12 +223,8 @@ static string_value_type *back(struct String_ const *string) {
 static void clear(struct String_ *string) {
     ensureNotNull(string, __FUNCTION__);
     string->PRIVATEensureNotFreed(string, __FUNCTION__);
-    memset(string->data(string),
-           0,
-           (string->capacity(string) + ONE) *
-           sizeof(string_value_type)
-          );
-    string->PRIVATEsize_ = ZERO;
+    string->PRIVATEsize_ = ZERO; // the old bytes are past the end now, overwriting them would only touch memory
+    string->PRIVATEdata_[ZERO] = '\0';
 }
 
 static void PRIVATEensureNotFreed(struct String_ const *string, string_value_type const *func) {
@@ -245,18 +253,32 @@ static void fromBuffer(struct String_ *string, string_value_type const *buffer)
     if (!string->PRIVATEfits(string, lenOfBuf)) {
         string->PRIVATEgrowToFit(string, lenOfBuf);
     }
-    string->clear(string);
-    strcpy(string->data(string), buffer);
-    string->PRIVATEsize_ = lenOfBuf;
+    string->PRIVATEsize_ = ZERO; // the old content gets overwritten, no need to clear it first
+    string->appendBytes(string, buffer, lenOfBuf);
+}
+
+static string_size_type PRIVATEsizeClass(struct String_ const *string, string_size_type required) { /* the capacity to grow to for required bytes:
+    * the buffer (capacity + '\0') is a power of two, like the kmalloc caches, so nothing of the slab object is wasted
+    * and appending N bytes causes O(log N) reallocations. Never more than maxCapacity_, 0 if required does not fit at all.
+    */
+    ensureNotNull(string, __FUNCTION__);
+    if (required > string->PRIVATEmaxCapacity_) {
+        return ZERO;
+    }
+    if (required >= string->PRIVATEmaxCapacity_ / (string_size_type)2U) { // the next class would be past the cap
+        return string->PRIVATEmaxCapacity_;
+    }
+    return (string_size_type)roundup_pow_of_two(required + ONE) - ONE;
 }
 
 static void PRIVATEgrowToAppend(struct String_ *string, string_size_type newCharsNeeded) {
     ensureNotNull(string, __FUNCTION__);
-    string_size_type growthFactor = string->PRIVATEgrowthFactor;
     string_size_type oldSize = string->size(string);
-    string_size_type reqSize = oldSize + newCharsNeeded;
-    string_size_type newCap = (string_size_type)(reqSize * growthFactor);
-    string->PRIVATEchangeCapacity(string, newCap);
+    if (oldSize > string->PRIVATEmaxCapacity_ || newCharsNeeded > string->PRIVATEmaxCapacity_ - oldSize) {
+        PRINT_DEBUG("%zu more bytes would exceed the maximum capacity of %zu in %s\n", newCharsNeeded, string->PRIVATEmaxCapacity_, __FUNCTION__);
+        return;
+    }
+    string->PRIVATEchangeCapacity(string, string->PRIVATEsizeClass(string, oldSize + newCharsNeeded));
 }
 
 static BOOL PRIVATEcanBeAppended(struct String_ const *string, string_size_type charsNeeded) {
@@ -274,32 +296,41 @@ static BOOL PRIVATEfits(struct String_ const *string, string_size_type otherLen)
 
 static void PRIVATEgrowToFit(struct String_ *string, string_size_type fitThis) {
     ensureNotNull(string, __FUNCTION__);
-    string_size_type growTo = (string_size_type)(string->PRIVATEgrowthFactor * fitThis);
+    string_size_type growTo = string->PRIVATEsizeClass(string, fitThis);
+    if (growTo == ZERO) {
+        PRINT_DEBUG("%zu bytes exceed the maximum capacity of %zu in %s\n", fitThis, string->PRIVATEmaxCapacity_, __FUNCTION__);
+        return;
+    }
     string->PRIVATEchangeCapacity(string, growTo);
 }
 
 static void toBuffer(struct String_ const *string, string_value_type *bufferToModify, string_size_type bufSiz) {
     assertTrue((bufferToModify != NULL), "bufferToModify in toBuffer was null!");
     ensureNotNull(string, __FUNCTION__);
-    strncpy(bufferToModify, string->data(string), bufSiz);
-    bufferToModify[bufSiz - ONE] = '\0';
+    if (bufSiz == ZERO) {
+        return;
+    }
+    string_size_type count = min(string->size(string), bufSiz - ONE); // the bytes are copied as they are, a '\0' among them ends the C string early
+    memcpy(bufferToModify, string->data(string), count * sizeof(string_value_type));
+    bufferToModify[count] = '\0';
 }
 
 static void append(struct String_ *string, string_value_type const *appendMe) {
     assertTrue((appendMe != NULL), "appendMe in append was null!");
     ensureNotNull(string, __FUNCTION__);
-    string_size_type len = strlen(appendMe);
-    if (!string->PRIVATEcanBeAppended(string, len)) {
-        string->PRIVATEgrowToAppend(string, len);
-    }
-    strcat(string->data(string), appendMe);
-    string->PRIVATEsize_ += len;
+    string->appendBytes(string, appendMe, strlen(appendMe)); // only appendMe is scanned, the end of the String is known
 }
 
 static int compare(struct String_ const *string, string_value_type const *other) {
     assertTrue((other != NULL), "other in compare was NULL!");
     ensureNotNull(string, __FUNCTION__);
-    return strcmp(string->data(string), other);
+    string_size_type size = string->size(string);
+    string_size_type otherLen = strlen(other);
+    int result = memcmp(string->data(string), other, min(size, otherLen) * sizeof(string_value_type)); // like strcmp, but a '\0' in the String is compared too
+    if (result != 0) {
+        return result;
+    }
+    return (size > otherLen) - (size < otherLen);
 }
 
 static BOOL equals(struct String_ const *string, string_value_type const *other) {
@@ -315,10 +346,7 @@ static void fillWith(struct String_ *string, string_value_type character) {
 
 static void pushBack(struct String_ *receiver, string_value_type theChar) {
     ensureNotNull(receiver, __FUNCTION__);
-    string_value_type arr[(string_size_type)2U];
-    arr[ZERO] = theChar;
-    arr[ONE] = '\0';
-    receiver->append(receiver, arr);
+    receiver->appendBytes(receiver, &theChar, ONE);
 }
 
 static string_value_type popBack(struct String_ *receiver) {
@@ -350,6 +378,9 @@ static void pushFront(struct String_ *receiver, string_value_type theChar) {
     string_size_type len = receiver->size(receiver);
     if (!receiver->PRIVATEcanBeAppended(receiver, ONE)) {
         receiver->PRIVATEgrowToAppend(receiver, ONE);
+        if (!receiver->PRIVATEcanBeAppended(receiver, ONE)) { // out of memory or at maxCapacity, the String is unchanged
+            return;
+        }
     }
 
     string_value_type *pBuf = receiver->data(receiver);
@@ -361,14 +392,19 @@ static void pushFront(struct String_ *receiver, string_value_type theChar) {
 
 static void prepend(struct String_ *receiver, string_value_type const *str) {
     assertTrue((str != NULL), "str in prepend was null");
-    string_size_type size = receiver->size(receiver) + ONE;
-    string_value_type *buf = HEAP_ALLOC8(size * sizeof(string_value_type));
-    assertTrue((buf != NULL), "buf was null in prepend");
-    receiver->toBuffer(receiver, buf, size);
-    receiver->clear(receiver);
-    receiver->fromBuffer(receiver, str);
-    receiver->append(receiver, buf);
-    kfree(buf);
+    string_size_type len = strlen(str);
+    if (!receiver->PRIVATEcanBeAppended(receiver, len)) {
+        receiver->PRIVATEgrowToAppend(receiver, len);
+        if (!receiver->PRIVATEcanBeAppended(receiver, len)) { // out of memory, the String is unchanged
+            return;
+        }
+    }
+    string_size_type size = receiver->size(receiver);
+    string_value_type *pBuf = receiver->data(receiver);
+    memmove(pBuf + len, pBuf, size * sizeof(string_value_type)); // make room in place, the content may contain '\0'
+    memcpy(pBuf, str, len * sizeof(string_value_type));
+    receiver->PRIVATEsize_ += len;
+    pBuf[receiver->PRIVATEsize_] = '\0';
 }
 
 static string_value_type popFront(struct String_ *receiver) {
@@ -387,19 +423,63 @@ static string_value_type popFront(struct String_ *receiver) {
     return ret;
 }
 
-static void *myRealloc(void *ptr, size_t oldSize, size_t newSize) {
+static void appendBytes(struct String_ *string, string_value_type const *bytes, string_size_type length) { // costs O(length), bytes may contain '\0'
+    assertTrue((bytes != NULL || length == ZERO), "bytes in appendBytes was null!");
+    ensureNotNull(string, __FUNCTION__);
+    if (!string->PRIVATEcanBeAppended(string, length)) {
+        string->PRIVATEgrowToAppend(string, length);
+        if (!string->PRIVATEcanBeAppended(string, length)) { // out of memory, the String is unchanged
+            return;
+        }
+    }
+    memcpy(string->PRIVATEdata_ + string->PRIVATEsize_, bytes, length * sizeof(string_value_type));
+    string->PRIVATEsize_ += length;
+    string->PRIVATEdata_[string->PRIVATEsize_] = '\0'; // data stays a C string for callers that never append a '\0'
+}
+
+static string_size_type consume(struct String_ *string, string_size_type count) { // removes up to count bytes from the front, returns how many were removed
+    ensureNotNull(string, __FUNCTION__);
+    string->PRIVATEensureNotFreed(string, __FUNCTION__);
+    count = min(count, string->PRIVATEsize_);
+    string_size_type rest = string->PRIVATEsize_ - count;
+    memmove(string->PRIVATEdata_, string->PRIVATEdata_ + count, rest * sizeof(string_value_type));
+    string->PRIVATEsize_ = rest;
+    string->PRIVATEdata_[rest] = '\0';
+    return count;
+}
+
+static string_size_type peek(struct String_ const *string, string_value_type *destination, string_size_type count) { // copies up to count bytes from the front without removing them
+    assertTrue((destination != NULL || count == ZERO), "destination in peek was null!");
+    ensureNotNull(string, __FUNCTION__);
+    string->PRIVATEensureNotFreed(string, __FUNCTION__);
+    count = min(count, string->PRIVATEsize_);
+    memcpy(destination, string->PRIVATEdata_, count * sizeof(string_value_type));
+    return count;
+}
+
+static StringView view(struct String_ const *string) {
+    ensureNotNull(string, __FUNCTION__);
+    string->PRIVATEensureNotFreed(string, __FUNCTION__);
+    StringView view = { string->PRIVATEdata_, string->PRIVATEsize_ };
+    return view;
+}
+
+static void *myRealloc(void *ptr, size_t newSize) { // ptr stays valid if this fails
     if (ptr == NULL) {
         goto err;
     }
-    void *newMem = HEAP_ALLOC8(newSize); // allocate the new memory
-    memcpy(newMem, ptr, oldSize); // copy the old data to the new memory
-    kfree(ptr); // free the old memory
-    return newMem;
+    return krealloc(ptr, newSize, GFP_KERNEL); /* grows in place while newSize fits the slab object, otherwise copies the old bytes over.
+        Nothing is zeroed, the String never reads past its size. */
     
 err:
     return NULL;
 }
 
+static void setMaxCapacity(struct String_ *string, string_size_type maxCapacity) { // does not shrink the String, only stops it from growing past maxCapacity
+    ensureNotNull(string, __FUNCTION__);
+    string->PRIVATEmaxCapacity_ = min(maxCapacity, STRING_MAX_CAPACITY);
+}
+
 static void assertTrue(BOOL boolean, char const *funcName) {
 #ifdef DEBUG_MODE
     if (!boolean) {
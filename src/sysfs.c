@@ -0,0 +1,129 @@
+#include "Sysfs.h"
+#include "Device.h"
+#include "Caesar.h"
+
+static ssize_t offset_show(struct device *node, struct device_attribute *attribute, char *buf);
+static ssize_t offset_store(struct device *node, struct device_attribute *attribute, char const *buf, size_t count);
+static ssize_t capacity_show(struct device *node, struct device_attribute *attribute, char *buf);
+static ssize_t capacity_store(struct device *node, struct device_attribute *attribute, char const *buf, size_t count);
+static ssize_t caesar_implementation_show(TRANS_CLASS_CONST struct class *transClass, TRANS_CLASS_CONST struct class_attribute *attribute, char *buf);
+static ssize_t caesar_implementation_store(TRANS_CLASS_CONST struct class *transClass, TRANS_CLASS_CONST struct class_attribute *attribute, char const *buf, size_t count);
+static ssize_t caesar_throughput_show(TRANS_CLASS_CONST struct class *transClass, TRANS_CLASS_CONST struct class_attribute *attribute, char *buf);
+
+static DEVICE_ATTR_RW(offset); /* dev_attr_offset, uses offset_show and offset_store. The kernel macros dictate these names. */
+static DEVICE_ATTR_RW(capacity);
+
+static struct attribute *transDeviceAttributes[] = {
+    &dev_attr_offset.attr,
+    &dev_attr_capacity.attr,
+    NULL,
+};
+
+static struct attribute_group const transDeviceGroup = {
+    .attrs = transDeviceAttributes,
+};
+
+struct attribute_group const *transDeviceGroups[] = {
+    &transDeviceGroup,
+    NULL,
+};
+
+static CLASS_ATTR_RW(caesar_implementation); /* class_attr_caesar_implementation, module wide, it is the same for every device */
+static CLASS_ATTR_RO(caesar_throughput);
+
+static ssize_t offset_show(struct device *node, struct device_attribute *attribute, char *buf) {
+    TransDevice *device = dev_get_drvdata(node);
+    return scnprintf(buf, PAGE_SIZE, "%d\n", transDeviceOffset(device));
+}
+
+static ssize_t offset_store(struct device *node, struct device_attribute *attribute, char const *buf, size_t count) { // echo 5 > /sys/class/translate/trans0/offset
+    TransDevice *device = dev_get_drvdata(node);
+    int offset;
+    int retVal = kstrtoint(buf, 10, &offset);
+    if (retVal != 0) {
+        return retVal;
+    } // end if
+    retVal = transDeviceSetOffset(device, offset);
+    if (retVal != EXIT_OK) {
+        return retVal;
+    } // end if
+    PRINT_DEBUG("trans%d now uses the offset %d\n", device->minorNumber, offset);
+    return count;
+}
+
+static ssize_t capacity_show(struct device *node, struct device_attribute *attribute, char *buf) {
+    TransDevice *device = dev_get_drvdata(node);
+    return scnprintf(buf, PAGE_SIZE, "%zu\n", device->ring.capacity(&device->ring));
+}
+
+static ssize_t capacity_store(struct device *node, struct device_attribute *attribute, char const *buf, size_t count) { // echo 65536 > /sys/class/translate/trans0/capacity
+    TransDevice *device = dev_get_drvdata(node);
+    unsigned int capacity;
+    int retVal = kstrtouint(buf, 10, &capacity);
+    if (retVal != 0) {
+        return retVal;
+    } // end if
+    retVal = transDeviceResize(device, capacity); // -EINVAL for 0 or too much, -ENOSPC if the queued bytes do not fit, -EBUSY while mapped
+    if (retVal != EXIT_OK) {
+        return retVal;
+    } // end if
+    PRINT_DEBUG("trans%d now holds up to %u bytes\n", device->minorNumber, capacity);
+    return count;
+}
+
+static ssize_t caesar_implementation_show(TRANS_CLASS_CONST struct class *transClass, TRANS_CLASS_CONST struct class_attribute *attribute, char *buf) {
+    /* the implementations this CPU can run, the one in use in brackets, like the I/O schedulers in /sys/block/<disk>/queue/scheduler */
+    ssize_t length = 0;
+    for (int i = 0; i < CAESAR_IMPLEMENTATIONS; ++i) {
+        if (!caesarImplementationAvailable((CaesarImplementation)i)) {
+            continue;
+        } // end if
+        char const *format = ((CaesarImplementation)i == getCaesarImplementation()) ? "%s[%s]" : "%s%s";
+        length += scnprintf(buf + length, PAGE_SIZE - length, format, (length == 0) ? "" : " ", caesarImplementationNames[i]);
+    } // end for
+    length += scnprintf(buf + length, PAGE_SIZE - length, "\n");
+    return length;
+}
+
+static ssize_t caesar_implementation_store(TRANS_CLASS_CONST struct class *transClass, TRANS_CLASS_CONST struct class_attribute *attribute, char const *buf, size_t count) {
+    /* echo sse2 > /sys/class/translate/caesar_implementation, for A/B tests without reloading the module */
+    int implementation = findCaesarImplementation(buf);
+    if (implementation < 0) {
+        return implementation;
+    } // end if
+    int retVal = setCaesarImplementation((CaesarImplementation)implementation); // -EINVAL if this CPU can not run it
+    if (retVal != EXIT_OK) {
+        return retVal;
+    } // end if
+    PRINT_INFO("now using the caesar implementation %s\n", caesarImplementationNames[implementation]);
+    return count;
+}
+
+static ssize_t caesar_throughput_show(TRANS_CLASS_CONST struct class *transClass, TRANS_CLASS_CONST struct class_attribute *attribute, char *buf) {
+    /* one line per implementation this CPU can run, its name and the MB/s moduleInit measured */
+    ssize_t length = 0;
+    for (int i = 0; i < CAESAR_IMPLEMENTATIONS; ++i) {
+        if (caesarImplementationAvailable((CaesarImplementation)i)) {
+            length += scnprintf(buf + length, PAGE_SIZE - length, "%s %u\n", caesarImplementationNames[i], caesarImplementationThroughput((CaesarImplementation)i));
+        } // end if
+    } // end for
+    return length;
+}
+
+int createClassFiles(struct class *transClass) {
+    int retVal = class_create_file(transClass, &class_attr_caesar_implementation);
+    if (retVal != 0) {
+        return retVal;
+    } // end if
+    retVal = class_create_file(transClass, &class_attr_caesar_throughput);
+    if (retVal != 0) {
+        class_remove_file(transClass, &class_attr_caesar_implementation);
+        return retVal;
+    } // end if
+    return EXIT_OK;
+}
+
+void removeClassFiles(struct class *transClass) {
+    class_remove_file(transClass, &class_attr_caesar_throughput);
+    class_remove_file(transClass, &class_attr_caesar_implementation);
+}